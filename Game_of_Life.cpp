@@ -7,13 +7,30 @@
  * @date March, 2020
  */
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 
 // Uses cxxopts from https://github.com/jarro2783/cxxopts under the MIT license
 #include "cxxopts/cxxopts.hxx"
 
+#include "batch.h"
+#include "checkpoint.h"
+#include "engine.h"
+#include "frames.h"
 #include "grid.h"
+#include "pipeline.h"
+#include "recording.h"
+#include "renderer.h"
+#include "server.h"
+#include "stats.h"
+#include "viewer.h"
 #include "world.h"
 #include "zoo.h"
 
@@ -28,7 +45,35 @@ int main(int argc, char *argv[]) {
             ("o,output", "Save an ascii file to the provided path.",  cxxopts::value<std::string>())
             ("s,steps","The number of steps to simulate the world.", cxxopts::value<int>()->default_value("10"))
             ("e,every","Print world to the console every N steps. 0 disables printing.", cxxopts::value<int>()->default_value("0"))
+            ("view", "Watch the world live, downsampled to the terminal and redrawn incrementally. Not with --every or --frames -.", cxxopts::value<bool>()->default_value("false"))
+            ("view-glyphs", "The glyphs used by --view, braille or half.", cxxopts::value<std::string>()->default_value("braille"))
+            ("fps", "The maximum number of frames per second drawn by --view.", cxxopts::value<double>()->default_value("30"))
+            ("render-thread", "Print the world from a separate render thread.", cxxopts::value<bool>()->default_value("false"))
+            ("frames", "Stream PBM frames to the provided path, or - for standard output.", cxxopts::value<std::string>())
+            ("frames-every", "Write a frame every N steps.", cxxopts::value<int>()->default_value("1"))
+            ("frames-scale", "Enlarge frames by an integer factor.", cxxopts::value<int>()->default_value("1"))
+            ("frames-pgm", "Write PGM frames averaging K x K cells per pixel instead. 0 writes PBM.", cxxopts::value<int>()->default_value("0"))
+            ("lag-policy", "Comma separated consumer=policy entries for the render, frames and view consumers when they fall behind the simulation, each block, drop or latest.", cxxopts::value<std::string>()->default_value("render=block,frames=block,view=latest"))
+            ("pipeline-depth", "The number of generations buffered between the simulation and its consumers.", cxxopts::value<int>()->default_value("4"))
             ("t,toroidal", "Simulate the Game of Life on a torus.", cxxopts::value<bool>()->default_value("false"))
+            ("grow", "Grow the world to keep N dead cells around the pattern. 0 keeps a fixed size.", cxxopts::value<int>()->default_value("0"))
+            ("shrink", "Also shrink a growing world when the pattern contracts.", cxxopts::value<bool>()->default_value("false"))
+            ("checkpoint-every", "Write a checkpoint every N steps. 0 disables checkpoints.", cxxopts::value<int>()->default_value("0"))
+            ("checkpoint-dir", "The directory to write checkpoints to.", cxxopts::value<std::string>()->default_value("checkpoints"))
+            ("resume", "Resume from the latest valid checkpoint in the checkpoint directory.", cxxopts::value<bool>()->default_value("false"))
+            ("record", "Record every generation to a seekable .rgol recording at the provided path.", cxxopts::value<std::string>())
+            ("keyframe-every", "Write a recording keyframe every N generations.", cxxopts::value<int>()->default_value("1000"))
+            ("stats", "Stream per-generation statistics to the provided path, as JSON lines for .json or .jsonl, otherwise CSV.", cxxopts::value<std::string>())
+            ("stats-counters", "Add hardware performance counters of each step to the statistics.", cxxopts::value<bool>()->default_value("false"))
+            ("stats-every", "Summarise every N generations in each statistics row.", cxxopts::value<int>()->default_value("1"))
+            ("engine", "The stepping engine, reference, auto, or a registered engine such as rowsum or threaded:4.", cxxopts::value<std::string>()->default_value("reference"))
+            ("retune-every", "With --engine auto, tune the engine again every N steps. 0 tunes once.", cxxopts::value<int>()->default_value("0"))
+            ("serve", "Answer queries about the running simulation on a Unix domain socket at the provided path.", cxxopts::value<std::string>())
+            ("batch", "Simulate every input in a manifest file, one path per line, or matching a glob pattern, then exit.", cxxopts::value<std::string>())
+            ("batch-output", "The directory --batch saves its results to.", cxxopts::value<std::string>()->default_value("batch_output"))
+            ("batch-threads", "The number of worker threads for --batch. 0 uses every hardware thread.", cxxopts::value<int>()->default_value("0"))
+            ("batch-summary", "Also write the --batch summary as CSV to the provided path.", cxxopts::value<std::string>())
+            ("validate", "Check a stepping engine matches the reference World::step, then exit.", cxxopts::value<std::string>())
             ("h,help", "Print usage.");
 
     // Actually parse the command line arguments
@@ -40,18 +85,119 @@ int main(int argc, char *argv[]) {
         std::exit(0);
     }
 
+    // Validate an engine in lockstep with the reference implementation instead of running a simulation
+    if (result.count("validate")) {
+        try {
+            std::exit(Engine::validate(result["validate"].as<std::string>(), std::cout) ? 0 : 1);
+        }
+        catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl;
+            std::exit(-1);
+        }
+    }
+
+    // Run every input of a batch on a pool of workers instead of a single simulation
+    if (result.count("batch")) {
+        try {
+            Batch batch(result["steps"].as<int>(), result["toroidal"].as<bool>(),
+                        result["batch-output"].as<std::string>(), result["engine"].as<std::string>(),
+                        result["batch-threads"].as<int>());
+            std::vector<Batch::Job> jobs = batch.run(Batch::find_inputs(result["batch"].as<std::string>()));
+
+            Batch::write_summary(std::cout, jobs);
+            if (result.count("batch-summary")) {
+                std::ofstream summary(result["batch-summary"].as<std::string>());
+                if (!summary) {
+                    throw std::invalid_argument("File not found.");
+                }
+                Batch::write_summary(summary, jobs, true);
+            }
+
+            bool failed = std::any_of(jobs.begin(), jobs.end(), [](const Batch::Job &job) {
+                return !job.error.empty();
+            });
+            std::exit(failed ? 1 : 0);
+        }
+        catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl;
+            std::exit(-1);
+        }
+    }
+
     // Parse the (potentially defaulted) parameters for this simulation
-    const int  steps    = result["steps"].as<int>();
-    const int  every    = result["every"].as<int>();
-    const bool toroidal = result["toroidal"].as<bool>();
+    int        steps            = result["steps"].as<int>();
+    const int  every            = result["every"].as<int>();
+    bool       toroidal         = result["toroidal"].as<bool>();
+    const int  checkpoint_every = result["checkpoint-every"].as<int>();
+    const std::string checkpoint_dir = result["checkpoint-dir"].as<std::string>();
+    const bool view             = result["view"].as<bool>();
+    const int  frames_every     = result["frames-every"].as<int>();
+
+    // The live view redraws the terminal in place, so nothing else may write to standard output while it runs
+    if (view && (every > 0 || (result.count("frames") && result["frames"].as<std::string>() == "-"))) {
+        std::cerr << "--view cannot be combined with --every or --frames -." << std::endl;
+        std::exit(-1);
+    }
+
+    // Frames streamed to standard output push the console messages onto standard error
+    std::ostream &console = (result.count("frames") && result["frames"].as<std::string>() == "-") ? std::cerr
+                                                                                                   : std::cout;
+
+    // Statistics are only gathered when asked for, including the time spent loading the input
+    std::unique_ptr<Stats> stats;
+    if (result.count("stats")) {
+        try {
+            stats = std::make_unique<Stats>(result["stats"].as<std::string>(), result["stats-every"].as<int>(),
+                                            result["stats-counters"].as<bool>());
+        }
+        catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl;
+            std::exit(-1);
+        }
+    }
 
     // Start with an empty grid
     Grid grid;
+    int first_step = 0;
+    int first_offset_x = 0;
+    int first_offset_y = 0;
+    bool resumed = false;
+
+    // Attempt to resume from the latest checkpoint, keeping any settings given explicitly on the command line
+    if (result["resume"].as<bool>()) {
+        int saved_steps;
+        bool saved_toroidal;
+
+        auto start = std::chrono::steady_clock::now();
+        resumed = Checkpointer::load_latest(checkpoint_dir, grid, first_step, saved_steps, saved_toroidal,
+                                            first_offset_x, first_offset_y);
+        if (stats) {
+            stats->record_io(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        if (resumed) {
+            steps = result.count("steps") ? steps : saved_steps;
+            toroidal = result.count("toroidal") ? toroidal : saved_toroidal;
+            console << "Resuming from step " << first_step << "..." << std::endl;
+        } else {
+            std::cerr << "No valid checkpoint found in " << checkpoint_dir << ", starting from scratch." << std::endl;
+        }
+    }
+
+    // Recordings number their generations from 0, so a resumed run cannot be recorded without renumbering it
+    if (resumed && result.count("record")) {
+        std::cerr << "--record cannot be combined with a run resumed from a checkpoint." << std::endl;
+        std::exit(-1);
+    }
 
     // Attempt to read in and parse the input file as an ascii .gol file if a path was given
-    if (result.count("file")) {
+    if (!resumed && result.count("file")) {
         try {
+            auto start = std::chrono::steady_clock::now();
             grid = Zoo::load_ascii(result["file"].as<std::string>());
+            if (stats) {
+                stats->record_io(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
         }
         catch (const std::exception &ex) {
             std::cerr << ex.what() << std::endl;
@@ -61,32 +207,197 @@ int main(int argc, char *argv[]) {
 
     // Construct a world from the parsed grid
     World world(grid);
+    const int grow = result["grow"].as<int>();
+    if (grow > 0) {
+        world.set_auto_grow(grow, result["shrink"].as<bool>());
+    }
+    try {
+        world.set_engine(result["engine"].as<std::string>(), result["retune-every"].as<int>());
+    }
+    catch (const std::exception &ex) {
+        std::cerr << ex.what() << std::endl;
+        std::exit(-1);
+    }
+    world.set_generation(first_step);
+    world.set_offset(first_offset_x, first_offset_y);
+
+    // Queries are answered from snapshots on the server's thread while the simulation runs
+    std::unique_ptr<QueryServer> server;
+    if (result.count("serve")) {
+        try {
+            server = std::make_unique<QueryServer>(result["serve"].as<std::string>());
+            server->publish(world.snapshot());
+        }
+        catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl;
+            std::exit(-1);
+        }
+    }
 
-    // Print the initial state of the grid
-    std::cout << "Initial state..." << std::endl
-              << "Alive " << world.get_alive_cells() << " | Dead " << world.get_dead_cells()  << std::endl
-              << world.get_state() << std::endl;
+    // Print the initial state of the grid, the live view draws it instead
+    console << "Initial state..." << std::endl
+            << "Alive " << world.get_alive_cells() << " | Dead " << world.get_dead_cells()  << std::endl;
+    if (!view) {
+        console << world.get_state() << std::endl;
+    }
+
+    // Checkpoints are written on a background thread while the simulation carries on
+    std::unique_ptr<Checkpointer> checkpointer;
+    if (checkpoint_every > 0) {
+        try {
+            checkpointer = std::make_unique<Checkpointer>(checkpoint_dir);
+
+            // Checkpoints of another run would outrank this run's on the next --resume, and are never removed
+            if (!resumed && !checkpointer->is_empty()) {
+                throw std::runtime_error("Checkpoint directory " + checkpoint_dir + " already holds checkpoints, "
+                                         "continue that run with --resume or choose another --checkpoint-dir.");
+            }
+        }
+        catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl;
+            std::exit(-1);
+        }
+    }
+
+    // Frames printed every N steps are formatted in bulk, optionally on a render thread
+    Renderer renderer(console, result["render-thread"].as<bool>());
+
+    // The live view is capped to its own frame rate
+    std::unique_ptr<Viewer> viewer;
+    if (view) {
+        viewer = std::make_unique<Viewer>(result["view-glyphs"].as<std::string>() == "half" ? Viewer::HALF_BLOCK
+                                                                                          : Viewer::BRAILLE,
+                                          result["fps"].as<double>());
+        viewer->show(world.get_state(), first_step, true);
+    }
 
     // Perform the requested number of update steps
-    for (int step = 0; step < steps; step++) {
-        world.step(toroidal);
+    try {
+        // Recordings hold every generation from the initial state onwards
+        std::unique_ptr<Recorder> recorder;
+        if (result.count("record")) {
+            recorder = std::make_unique<Recorder>(result["record"].as<std::string>(),
+                                                  result["keyframe-every"].as<int>());
+            recorder->record(world.get_state());
+        }
+
+        // Frames start from the initial state
+        std::unique_ptr<FrameExporter> exporter;
+        if (result.count("frames")) {
+            exporter = std::make_unique<FrameExporter>(result["frames"].as<std::string>(),
+                                                       result["frames-scale"].as<int>(),
+                                                       result["frames-pgm"].as<int>());
+            exporter->write(world.get_state());
+        }
+
+        // Each consumer falls behind according to its --lag-policy entry, recordings need every generation
+        std::map<std::string, Pipeline::Policy> policies = {
+                {"render", Pipeline::BLOCK}, {"frames", Pipeline::BLOCK},
+                {"view", Pipeline::LATEST}
+        };
+        std::stringstream entries(result["lag-policy"].as<std::string>());
+        std::string entry;
+        while (std::getline(entries, entry, ',')) {
+            const std::size_t equals = entry.find('=');
+            if (equals == std::string::npos || policies.count(entry.substr(0, equals)) == 0) {
+                throw std::invalid_argument("Policy not valid.");
+            }
+            policies[entry.substr(0, equals)] = Pipeline::parse_policy(entry.substr(equals + 1));
+        }
+
+        // Generations are handed to the consumers on their own threads, so none of them stall the simulation
+        Pipeline pipeline(result["pipeline-depth"].as<int>());
+
+        if (recorder) {
+            pipeline.add_consumer(Pipeline::BLOCK, [&](const Grid &grid, int) { recorder->record(grid); });
+        }
+
+        if (exporter && frames_every > 0) {
+            pipeline.add_consumer(policies["frames"],
+                                  [&](const Grid &grid, int) { exporter->write(grid); },
+                                  [=](int generation) { return generation % frames_every == 0; });
+        }
+
+        if (viewer) {
+            pipeline.add_consumer(policies["view"],
+                                  [&](const Grid &grid, int generation) {
+                                      viewer->show(grid, generation, generation == steps);
+                                  });
+        }
 
         // Print the state of the grid every N steps
-        if ((every > 0) && (step % every == 0)) {
-            std::cout << "Step " << (step + 1) << " of " << steps << std::endl
-                      << world.get_state() << std::endl;
+        if (every > 0) {
+            pipeline.add_consumer(policies["render"],
+                                  [&](const Grid &grid, int generation) {
+                                      renderer.render(grid, "Step " + std::to_string(generation) + " of "
+                                                            + std::to_string(steps) + "\n");
+                                  },
+                                  [=](int generation) { return (generation - 1) % every == 0; });
+        }
+
+        for (int step = first_step; step < steps; step++) {
+            if (server) {
+                server->hold(world);
+            }
+
+            if (stats) {
+                stats->start_step();
+                world.step(toroidal);
+                stats->finish_step(step + 1, world);
+            } else {
+                world.step(toroidal);
+            }
+
+            pipeline.publish(world.get_state(), step + 1);
+
+            // Checkpoints are packed to an eighth of the grid here, a pipeline slot would hold two full copies
+            if (checkpointer && ((step + 1) % checkpoint_every == 0)) {
+                checkpointer->save(world.get_state(), step + 1, steps, toroidal, world.get_offset_x(),
+                                   world.get_offset_y());
+            }
+        }
+
+        // Queries made after the last step are answered from the final state
+        if (server) {
+            server->publish(world.snapshot());
+        }
+
+        pipeline.close();
+
+        if (checkpointer) {
+            checkpointer->wait();
+        }
+
+        if (recorder) {
+            recorder->close();
         }
     }
+    catch (const std::exception &ex) {
+        std::cerr << ex.what() << std::endl;
+        std::exit(-1);
+    }
 
-    // Print the final state of the grid
-    std::cout << "Final state..." << std::endl
-              << "Alive " << world.get_alive_cells() << " | Dead " << world.get_dead_cells()  << std::endl
-              << world.get_state() << std::endl;
+    // Print the final state of the grid once every queued frame is out
+    renderer.flush();
+    viewer.reset();
+    console << "Final state..." << std::endl
+            << "Alive " << world.get_alive_cells() << " | Dead " << world.get_dead_cells()  << std::endl;
+    if (grow > 0) {
+        console << "Size " << world.get_width() << "x" << world.get_height()
+                << " | Offset " << world.get_offset_x() << "," << world.get_offset_y() << std::endl;
+    }
+    if (!view) {
+        console << world.get_state() << std::endl;
+    }
 
     // Attempt to save to the output directory if a path was given
     if (result.count("output")) {
         try {
+            auto start = std::chrono::steady_clock::now();
             Zoo::save_ascii(result["output"].as<std::string>(), world.get_state());
+            if (stats) {
+                stats->record_io(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
         }
         catch (const std::exception &ex) {
             std::cerr << ex.what() << std::endl;
@@ -94,6 +405,11 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // The closing statistics row holds the final save and any generations left over from the last window
+    if (stats) {
+        stats->close(std::max(steps, first_step), world);
+    }
+
     // Destructors handle all the memory deallocation
     return 0;
 }
@@ -0,0 +1,377 @@
+/**
+ * Benchmarks World::step across grid sizes, densities, workloads, topologies and engines.
+ * Results are written as JSON so runs on different commits can be compared.
+ *
+ * Run with -h or --help to print the usage message.
+ * i.e.
+ * ./Game_of_Life_benchmark --help
+ *
+ * Sizes are the edge length of a square world, the special size "ram" picks the smallest world whose two
+ * state buffers together need more than a quarter of the physical memory. Cells are counted with an int, so
+ * "ram" is capped at 46340, the largest edge whose cell count fits in one. Machines with more than 16 GiB of
+ * memory get the capped world, which no longer spills out of their caches by the same margin.
+ *
+ * Workloads:
+ *      - random       Each cell is alive with the given density, one run per density.
+ *      - gliders      A field of gliders in random orientations, one every 8x8 cells.
+ *      - r_pentomino  A burst of r-pentominoes in random orientations, one every 64x64 cells.
+ *
+ * Every world is built from a std::mt19937 seeded with --seed, so the same options always benchmark the
+ * same worlds. Each run is warmed up before its samples are timed. Every sample restarts from the same
+ * world and advances it enough generations to cover about 2^22 cells, at most 64, so sparse worlds do not
+ * die out over the course of a run.
+ *
+ * With --counters the hardware performance counters of each sample are read as well, and their medians are
+ * reported per generation and per cell. Counters the machine does not allow are reported as null.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// Uses cxxopts from https://github.com/jarro2783/cxxopts under the MIT license
+#include "cxxopts/cxxopts.hxx"
+
+#include "grid.h"
+#include "perf.h"
+#include "world.h"
+#include "zoo.h"
+
+/**
+ * The timings of one benchmarked configuration.
+ */
+struct Result {
+    std::string engine;
+    std::string workload;
+    int size;
+    double density;
+    bool toroidal;
+    int generations;
+    std::vector<double> seconds;
+    std::vector<PerfCounters::Sample> counts;
+};
+
+/**
+ * split(list)
+ *
+ * Split a comma separated list into its entries.
+ */
+
+std::vector<std::string> split(const std::string &list) {
+    std::vector<std::string> entries;
+    std::stringstream stream(list);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        if (!entry.empty()) {
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
+
+/**
+ * ram_size()
+ *
+ * The smallest square edge whose current and next state grids need more than a quarter of physical memory,
+ * capped at the largest edge whose cell count still fits in an int.
+ */
+
+int ram_size() {
+    const double bytes = double(sysconf(_SC_PHYS_PAGES)) * double(sysconf(_SC_PAGE_SIZE));
+    const double largest = std::floor(std::sqrt(double(std::numeric_limits<int>::max())));
+    return int(std::min(std::ceil(std::sqrt(bytes / 4 / 2)) + 1, largest));
+}
+
+/**
+ * random_world(size, density, rng)
+ *
+ * A square grid where each cell is alive with the given probability.
+ * Compares raw generator output rather than using a distribution, whose output is not fixed by the standard.
+ */
+
+Grid random_world(int size, double density, std::mt19937 &rng) {
+    const std::uint64_t threshold = std::uint64_t(density * 4294967296.0);
+
+    Grid grid(size);
+    for (int y = 0; y < size; ++y) {
+        Cell *row = grid.row(y);
+        for (int x = 0; x < size; ++x) {
+            row[x] = rng() < threshold ? Cell::ALIVE : Cell::DEAD;
+        }
+    }
+    return grid;
+}
+
+/**
+ * scattered_world(size, pattern, spacing, rng)
+ *
+ * A square grid with the pattern merged in a random orientation in the middle of every spacing x spacing block.
+ */
+
+Grid scattered_world(int size, const Grid &pattern, int spacing, std::mt19937 &rng) {
+    Grid orientations[4] = {pattern, pattern.rotate(1), pattern.rotate(2), pattern.rotate(3)};
+    const int extent = std::max(pattern.get_width(), pattern.get_height());
+    const int first = std::max(0, (std::min(spacing, size) - extent) / 2);
+
+    Grid grid(size);
+    for (int y = first; y + extent <= size; y += spacing) {
+        for (int x = first; x + extent <= size; x += spacing) {
+            grid.merge(orientations[rng() % 4], x, y, true);
+        }
+    }
+    return grid;
+}
+
+/**
+ * percentile(sorted, fraction)
+ *
+ * The nearest rank percentile of an ascending list of samples.
+ */
+
+double percentile(const std::vector<double> &sorted, double fraction) {
+    std::size_t rank = std::size_t(std::ceil(fraction * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+/**
+ * run(engine, grid, toroidal, warmup, repeats, result, counters)
+ *
+ * Time worlds built from the grid, filling in the seconds taken by each sample and the generations per sample,
+ * and the hardware counts of each sample when counters are given.
+ * Building the world for each sample is not timed.
+ */
+
+void run(const std::string &engine, const Grid &grid, bool toroidal, int warmup, int repeats, Result &result,
+         const PerfCounters *counters) {
+    const double cells = double(grid.get_total_cells());
+    result.generations = int(std::min(64.0, std::max(1.0, (1 << 22) / std::max(cells, 1.0))));
+
+    for (int i = -warmup; i < repeats; ++i) {
+        World world(grid);
+        world.set_engine(engine);
+        PerfCounters::Sample counts_start = {};
+        if (counters) {
+            counts_start = counters->read();
+        }
+        auto start = std::chrono::steady_clock::now();
+        world.advance(result.generations, toroidal);
+        auto end = std::chrono::steady_clock::now();
+        if (i >= 0) {
+            result.seconds.push_back(std::chrono::duration<double>(end - start).count());
+            if (counters) {
+                result.counts.push_back(PerfCounters::difference(counters->read(), counts_start));
+            }
+        }
+    }
+}
+
+/**
+ * median_count(counts, counter)
+ *
+ * The median count of a counter over the samples, or -1 if any sample is missing it.
+ */
+
+double median_count(const std::vector<PerfCounters::Sample> &counts, PerfCounters::Counter counter) {
+    std::vector<double> sorted;
+    for (const PerfCounters::Sample &sample : counts) {
+        if (sample.values[counter] < 0) {
+            return -1;
+        }
+        sorted.push_back(double(sample.values[counter]));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    return percentile(sorted, 0.5);
+}
+
+/**
+ * json_string(text)
+ *
+ * Quote a string for JSON, escaping quotes, backslashes and control characters.
+ */
+
+std::string json_string(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if ((unsigned char) c < 0x20) {
+            quoted += ' ';
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+/**
+ * write_json(stream, label, seed, warmup, repeats, results)
+ *
+ * Serialize the results as a single JSON document.
+ */
+
+void write_json(std::ostream &stream, const std::string &label, unsigned seed, int warmup, int repeats,
+                const std::vector<Result> &results) {
+    stream << "{\n"
+           << "  \"benchmark\": \"World::step\",\n"
+           << "  \"label\": " << json_string(label) << ",\n"
+           << "  \"seed\": " << seed << ",\n"
+           << "  \"warmup\": " << warmup << ",\n"
+           << "  \"repeats\": " << repeats << ",\n"
+           << "  \"results\": [";
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        std::vector<double> sorted = result.seconds;
+        std::sort(sorted.begin(), sorted.end());
+
+        const double cells = double(result.size) * result.size * result.generations;
+        const double median = percentile(sorted, 0.5);
+
+        stream << (i == 0 ? "\n" : ",\n")
+               << "    {\"engine\": " << json_string(result.engine)
+               << ", \"workload\": \"" << result.workload << "\""
+               << ", \"size\": " << result.size
+               << ", \"density\": " << result.density
+               << ", \"toroidal\": " << (result.toroidal ? "true" : "false")
+               << ", \"generations_per_sample\": " << result.generations
+               << ", \"seconds\": {\"min\": " << sorted.front()
+               << ", \"p10\": " << percentile(sorted, 0.1)
+               << ", \"median\": " << median
+               << ", \"p90\": " << percentile(sorted, 0.9)
+               << ", \"max\": " << sorted.back() << "}"
+               << ", \"generations_per_second\": " << result.generations / median
+               << ", \"cells_per_second\": {\"p10\": " << cells / percentile(sorted, 0.9)
+               << ", \"median\": " << cells / median
+               << ", \"p90\": " << cells / percentile(sorted, 0.1) << "}";
+
+        if (!result.counts.empty()) {
+            stream << ", \"counters\": {";
+            for (int counter = 0; counter < PerfCounters::COUNTERS; ++counter) {
+                const double count = median_count(result.counts, PerfCounters::Counter(counter));
+                stream << (counter == 0 ? "\"" : ", \"") << PerfCounters::get_name(PerfCounters::Counter(counter))
+                       << "\": ";
+                if (count < 0) {
+                    stream << "null";
+                } else {
+                    stream << "{\"per_generation\": " << count / result.generations
+                           << ", \"per_cell\": " << count / cells << "}";
+                }
+            }
+            stream << "}";
+        }
+        stream << "}";
+    }
+    stream << "\n  ]\n}" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+
+    cxxopts::Options options("Game_of_Life_benchmark",
+            "Benchmarks World::step across grid sizes, densities, workloads and topologies.");
+
+    options.add_options()
+            ("sizes", "Comma separated square world sizes, ram picks a size beyond a quarter of memory.", cxxopts::value<std::string>()->default_value("64,256,1024,4096"))
+            ("densities", "Comma separated densities for the random workload.", cxxopts::value<std::string>()->default_value("0.01,0.1,0.35"))
+            ("workloads", "Comma separated workloads, any of random, gliders and r_pentomino.", cxxopts::value<std::string>()->default_value("random,gliders,r_pentomino"))
+            ("engines", "Comma separated engines, reference, auto, or registered engines such as rowsum or threaded:4.", cxxopts::value<std::string>()->default_value("reference"))
+            ("modes", "Comma separated topologies, any of bounded and toroidal.", cxxopts::value<std::string>()->default_value("bounded,toroidal"))
+            ("warmup", "The number of untimed samples before timing.", cxxopts::value<int>()->default_value("3"))
+            ("repeats", "The number of timed samples.", cxxopts::value<int>()->default_value("15"))
+            ("seed", "The seed for building the worlds.", cxxopts::value<unsigned>()->default_value("42"))
+            ("counters", "Also report hardware performance counters per generation and per cell.")
+            ("label", "A label stored with the results, such as a commit id.", cxxopts::value<std::string>()->default_value(""))
+            ("o,output", "Write the JSON results to the provided path instead of standard output.", cxxopts::value<std::string>())
+            ("h,help", "Print usage.");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        std::exit(0);
+    }
+
+    const int warmup = result["warmup"].as<int>();
+    const int repeats = std::max(1, result["repeats"].as<int>());
+    const unsigned seed = result["seed"].as<unsigned>();
+
+    std::vector<Result> results;
+
+    // Counting starts once, each sample is measured by the difference of two reads
+    std::unique_ptr<PerfCounters> counters;
+    if (result.count("counters")) {
+        counters = std::make_unique<PerfCounters>();
+        if (!counters->is_available()) {
+            std::cerr << "Hardware performance counters are not available, their results will be null." << std::endl;
+        }
+    }
+
+    try {
+        for (const std::string &size_name : split(result["sizes"].as<std::string>())) {
+            const int size = size_name == "ram" ? ram_size() : std::stoi(size_name);
+
+            for (const std::string &workload : split(result["workloads"].as<std::string>())) {
+                std::vector<std::string> densities = {"0"};
+                if (workload == "random") {
+                    densities = split(result["densities"].as<std::string>());
+                } else if (workload != "gliders" && workload != "r_pentomino") {
+                    throw std::invalid_argument("Workload not valid.");
+                }
+
+                for (const std::string &density_name : densities) {
+                    const double density = std::stod(density_name);
+
+                    for (const std::string &mode : split(result["modes"].as<std::string>())) {
+                        if (mode != "bounded" && mode != "toroidal") {
+                            throw std::invalid_argument("Mode not valid.");
+                        }
+
+                        // Every configuration is built from the same seed so it can be run on its own
+                        std::mt19937 rng(seed);
+                        Grid grid = workload == "random" ? random_world(size, density, rng)
+                                  : workload == "gliders" ? scattered_world(size, Zoo::glider(), 8, rng)
+                                  : scattered_world(size, Zoo::r_pentomino(), 64, rng);
+
+                        for (const std::string &engine : split(result["engines"].as<std::string>())) {
+                            Result timing = {engine, workload, size, density, mode == "toroidal", 0, {}, {}};
+                            std::cerr << engine << " " << workload << " " << size << "x" << size << " density "
+                                      << density << " " << mode << "..." << std::endl;
+                            run(engine, grid, timing.toroidal, warmup, repeats, timing, counters.get());
+                            results.push_back(timing);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (result.count("output")) {
+            std::ofstream file(result["output"].as<std::string>());
+            if (!file) {
+                throw std::invalid_argument("File not found.");
+            }
+            write_json(file, result["label"].as<std::string>(), seed, warmup, repeats, results);
+        } else {
+            write_json(std::cout, result["label"].as<std::string>(), seed, warmup, repeats, results);
+        }
+    }
+    catch (const std::exception &ex) {
+        std::cerr << ex.what() << std::endl;
+        std::exit(-1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,390 @@
+/**
+ * Implements a class for simulating many input files in one process on a shared pool of worker threads.
+ *      - Inputs are listed in a manifest file, one path per line, or matched by a glob pattern.
+ *          - Blank manifest lines and lines starting with '#' are skipped.
+ *          - Relative manifest paths are relative to the manifest.
+ *
+ *      - Every input is loaded, advanced the same number of steps with the same topology and engine, and saved
+ *        into the output directory under its own file name. The format is chosen by the extension, for both
+ *        loading and saving:
+ *          - .bgol binary, .mc macrocell, .tgol tiled, anything else ascii.
+ *
+ *      - Jobs are handed to the workers largest first, so the biggest grids start straight away and the tail
+ *        of the batch is made of small jobs that keep every worker busy until the end.
+ *          - The size of a grid is read from the header of ascii, binary and tiled files. Macrocell files have
+ *            no size in their header, so their file size is used instead.
+ *
+ *      - A failed job records its error and the rest of the batch carries on.
+ *
+ *      - The "auto" engine is tuned once, on the largest input, before any worker starts, and every job steps
+ *        with the engine it picks. Tuning inside each job would time the candidates against each other's load.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <glob.h>
+#include "batch.h"
+#include "engine.h"
+#include "world.h"
+#include "zoo.h"
+
+namespace {
+
+    /**
+     * format_of(path)
+     *
+     * The file format named by the extension of a path.
+     */
+
+    std::string format_of(const std::string &path) {
+        const std::string extension = std::filesystem::path(path).extension().string();
+        return extension == ".bgol" ? "binary" : extension == ".mc" ? "macrocell"
+                                               : extension == ".tgol" ? "tiled" : "ascii";
+    }
+
+    /**
+     * estimate_cells(path)
+     *
+     * Estimate the number of cells in an input file from its header, or its size when it has no header.
+     * Returns 0 if the file cannot be read, so broken inputs are tried last and fail quickly.
+     */
+
+    long long estimate_cells(const std::string &path) {
+        const std::string format = format_of(path);
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return 0;
+        }
+
+        int width = 0;
+        int height = 0;
+        if (format == "ascii") {
+            file >> width >> height;
+        } else if (format == "binary" || format == "tiled") {
+            // Tiled files start with a 4 byte magic
+            file.seekg(format == "tiled" ? 4 : 0);
+            file.read(reinterpret_cast<char *>(&width), 4);
+            file.read(reinterpret_cast<char *>(&height), 4);
+        } else {
+            std::error_code error;
+            const auto size = std::filesystem::file_size(path, error);
+            return error ? 0 : (long long) size;
+        }
+        return file && width > 0 && height > 0 ? (long long) width * height : 0;
+    }
+
+    /**
+     * load(path)
+     *
+     * Load an input file in the format named by its extension.
+     */
+
+    Grid load(const std::string &path) {
+        const std::string format = format_of(path);
+        return format == "binary" ? Zoo::load_binary(path)
+             : format == "macrocell" ? Zoo::load_macrocell(path)
+             : format == "tiled" ? Zoo::load_tiled(path)
+             : Zoo::load_ascii(path);
+    }
+
+    /**
+     * seconds_since(start)
+     *
+     * The wall time since a point in time.
+     */
+
+    double seconds_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+/**
+ * Batch::Batch(steps, toroidal, output_directory, engine = "reference", threads = 0)
+ *
+ * Construct a batch that runs every input with the same settings.
+ *
+ * @example
+ *
+ *      // Advance every file listed in inputs.txt 100 steps on a torus, saving into results/
+ *      Batch batch(100, true, "results");
+ *      std::vector<Batch::Job> jobs = batch.run(Batch::find_inputs("inputs.txt"));
+ *      Batch::write_summary(std::cout, jobs);
+ *
+ * @param steps
+ *      The number of steps to advance each input.
+ *
+ * @param toroidal
+ *      If true the inputs are simulated on a torus.
+ *
+ * @param output_directory
+ *      The directory to save the results to, created if needed.
+ *
+ * @param engine
+ *      Optional parameter. The engine to step with, see World::set_engine. "auto" is tuned once for the whole
+ *      batch, see Batch::run. Defaults to "reference".
+ *
+ * @param threads
+ *      Optional parameter. The number of worker threads, 0 for one per hardware thread. Defaults to 0.
+ *
+ * @throws
+ *      std::invalid_argument if the number of steps or threads is negative.
+ */
+
+Batch::Batch(int steps, bool toroidal, std::string output_directory, std::string engine, int threads)
+        : steps(steps), toroidal(toroidal), output_directory(std::move(output_directory)), engine(std::move(engine)),
+          threads(threads) {
+    if (steps < 0) {
+        throw std::invalid_argument("Steps not valid.");
+    }
+    if (threads < 0) {
+        throw std::invalid_argument("Threads not valid.");
+    }
+}
+
+/**
+ * Batch::run(inputs)
+ *
+ * Simulate every input on the worker pool, largest first, and save the results.
+ * With the "auto" engine, the largest input that loads is tuned with Engine::tune before the pool starts.
+ *
+ * @param inputs
+ *      The paths of the input files.
+ *
+ * @return
+ *      A Batch::Job for every input, in the order given.
+ *
+ * @throws
+ *      std::invalid_argument if two inputs would be saved to the same output file.
+ *      std::filesystem::filesystem_error if the output directory cannot be created.
+ */
+
+std::vector<Batch::Job> Batch::run(const std::vector<std::string> &inputs) const {
+    std::vector<Job> jobs(inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        jobs[i].input = inputs[i];
+        jobs[i].output = (std::filesystem::path(output_directory)
+                          / std::filesystem::path(inputs[i]).filename()).string();
+        jobs[i].estimate = estimate_cells(inputs[i]);
+    }
+
+    std::vector<std::string> outputs;
+    for (const Job &job : jobs) {
+        outputs.push_back(job.output);
+    }
+    std::sort(outputs.begin(), outputs.end());
+    if (std::adjacent_find(outputs.begin(), outputs.end()) != outputs.end()) {
+        throw std::invalid_argument("Output names not valid.");
+    }
+    std::filesystem::create_directories(output_directory);
+
+    // Largest first, ties keep the order given
+    std::vector<std::size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&jobs](std::size_t a, std::size_t b) {
+        return jobs[a].estimate > jobs[b].estimate;
+    });
+
+    // Tune on an otherwise idle machine, the largest input stands in for the batch
+    std::string chosen = engine;
+    if (chosen == "auto") {
+        chosen = "reference";
+        for (std::size_t index : order) {
+            try {
+                chosen = Engine::tune(load(jobs[index].input), toroidal);
+                break;
+            }
+            catch (const std::exception &) {
+                // Its own job reports the error, try the next largest
+            }
+        }
+    }
+
+    // Each worker takes the next job in the order until there are none left
+    std::atomic<std::size_t> next(0);
+    auto work = [&]() {
+        for (std::size_t i = next++; i < order.size(); i = next++) {
+            run_job(jobs[order[i]], chosen);
+        }
+    };
+
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t count = std::min(jobs.size(), threads > 0 ? std::size_t(threads) : hardware);
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < count; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return jobs;
+}
+
+/**
+ * Batch::run_job(job, engine)
+ *
+ * Private helper that loads, advances and saves a single input with an engine, recording its timings, or its error.
+ */
+
+void Batch::run_job(Job &job, const std::string &engine) const {
+    try {
+        const std::string format = format_of(job.input);
+
+        auto start = std::chrono::steady_clock::now();
+        Grid grid = load(job.input);
+        job.load_seconds = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        World world(std::move(grid));
+        world.set_engine(engine);
+        world.advance(steps, toroidal);
+        job.step_seconds = seconds_since(start);
+
+        job.width = world.get_width();
+        job.height = world.get_height();
+        job.alive = world.get_alive_cells();
+
+        start = std::chrono::steady_clock::now();
+        if (format == "binary") {
+            Zoo::save_binary(job.output, world.get_state());
+        } else if (format == "macrocell") {
+            Zoo::save_macrocell(job.output, world.get_state());
+        } else if (format == "tiled") {
+            Zoo::save_tiled(job.output, world.get_state());
+        } else {
+            Zoo::save_ascii(job.output, world.get_state());
+        }
+        job.save_seconds = seconds_since(start);
+    }
+    catch (const std::exception &ex) {
+        job.error = ex.what();
+    }
+}
+
+/**
+ * Batch::find_inputs(source)
+ *
+ * List the input files named by a glob pattern, or by a manifest file with one path per line.
+ * A source containing any of *, ? or [ is treated as a glob pattern.
+ *
+ * @param source
+ *      The glob pattern or the path to the manifest.
+ *
+ * @return
+ *      The paths of the input files, sorted for a glob and in file order for a manifest.
+ *
+ * @throws
+ *      std::invalid_argument if the manifest cannot be opened or nothing is found.
+ */
+
+std::vector<std::string> Batch::find_inputs(const std::string &source) {
+    std::vector<std::string> inputs;
+
+    if (source.find_first_of("*?[") != std::string::npos) {
+        glob_t matches;
+        if (glob(source.c_str(), 0, nullptr, &matches) == 0) {
+            for (std::size_t i = 0; i < matches.gl_pathc; ++i) {
+                inputs.emplace_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    } else {
+        std::ifstream manifest(source);
+        if (!manifest) {
+            throw std::invalid_argument("File not found.");
+        }
+
+        const std::filesystem::path directory = std::filesystem::path(source).parent_path();
+        std::string line;
+        while (std::getline(manifest, line)) {
+            line.erase(0, std::min(line.find_first_not_of(" \t"), line.size()));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            const std::filesystem::path input(line);
+            inputs.push_back(input.is_relative() ? (directory / input).string() : line);
+        }
+    }
+
+    if (inputs.empty()) {
+        throw std::invalid_argument("No inputs found.");
+    }
+    return inputs;
+}
+
+/**
+ * Batch::write_summary(stream, jobs, csv = false)
+ *
+ * Write a table of the final size and population, and the timings, of every job.
+ * The text table ends with the totals of the batch.
+ *
+ * @param stream
+ *      The stream to write to.
+ *
+ * @param jobs
+ *      The jobs returned by Batch::run.
+ *
+ * @param csv
+ *      Optional parameter. If true write CSV with a header line instead of an aligned text table.
+ *      Defaults to false.
+ */
+
+void Batch::write_summary(std::ostream &stream, const std::vector<Job> &jobs, bool csv) {
+    if (csv) {
+        stream << "input,output,width,height,alive,load_seconds,step_seconds,save_seconds,error\n";
+        for (const Job &job : jobs) {
+            std::string error = job.error;
+            std::replace(error.begin(), error.end(), ',', ';');
+            stream << job.input << ',' << job.output << ',' << job.width << ',' << job.height << ','
+                   << job.alive << ',' << job.load_seconds << ',' << job.step_seconds << ','
+                   << job.save_seconds << ',' << error << '\n';
+        }
+        return;
+    }
+
+    std::size_t name_width = 5;
+    for (const Job &job : jobs) {
+        name_width = std::max(name_width, job.input.size());
+    }
+
+    const std::ios::fmtflags flags = stream.flags();
+    const std::streamsize precision = stream.precision();
+    stream << std::left << std::setw(int(name_width)) << "Input" << std::right
+           << std::setw(12) << "Size" << std::setw(12) << "Alive"
+           << std::setw(10) << "Load s" << std::setw(10) << "Step s" << std::setw(10) << "Save s" << "\n";
+
+    double load = 0;
+    double step = 0;
+    double save = 0;
+    int failed = 0;
+    stream << std::fixed << std::setprecision(3);
+    for (const Job &job : jobs) {
+        stream << std::left << std::setw(int(name_width)) << job.input << std::right;
+        if (!job.error.empty()) {
+            stream << "  failed: " << job.error << "\n";
+            failed++;
+            continue;
+        }
+        stream << std::setw(12) << (std::to_string(job.width) + "x" + std::to_string(job.height))
+               << std::setw(12) << job.alive
+               << std::setw(10) << job.load_seconds << std::setw(10) << job.step_seconds
+               << std::setw(10) << job.save_seconds << "\n";
+        load += job.load_seconds;
+        step += job.step_seconds;
+        save += job.save_seconds;
+    }
+    stream << jobs.size() - failed << " of " << jobs.size() << " inputs done | Load " << load << "s | Step "
+           << step << "s | Save " << save << "s" << std::endl;
+    stream.flags(flags);
+    stream.precision(precision);
+}
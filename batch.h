@@ -0,0 +1,54 @@
+/**
+ * Declares a class for simulating many input files in one process on a shared pool of worker threads.
+ * Rich documentation for the api and behaviour the Batch class can be found in batch.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Declare the structure of the Batch class for running the same simulation over a list of input files.
+ */
+class Batch {
+
+public:
+    /**
+     * The outcome of simulating one input file.
+     */
+    struct Job {
+        std::string input;
+        std::string output;
+        long long estimate = 0;
+        int width = 0;
+        int height = 0;
+        int alive = 0;
+        double load_seconds = 0;
+        double step_seconds = 0;
+        double save_seconds = 0;
+        std::string error;
+    };
+
+private:
+    int steps;
+    bool toroidal;
+    std::string output_directory;
+    std::string engine;
+    int threads;
+
+    void run_job(Job &job, const std::string &engine) const;
+
+public:
+    explicit Batch(int steps, bool toroidal, std::string output_directory, std::string engine = "reference",
+                   int threads = 0);
+
+    std::vector<Job> run(const std::vector<std::string> &inputs) const;
+
+    static std::vector<std::string> find_inputs(const std::string &source);
+
+    static void write_summary(std::ostream &stream, const std::vector<Job> &jobs, bool csv = false);
+};
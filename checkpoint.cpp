@@ -0,0 +1,411 @@
+/**
+ * Implements a class for writing crash-safe checkpoints of a running simulation.
+ *      - Checkpoints hold the current Grid state, the generation counter, the auto-grow offset of the grid, and the
+ *        simulation settings.
+ *      - The grid is bit-packed on the calling thread, which needs an eighth of the memory of the grid,
+ *        then compressed and written on a background thread so the simulation never waits on the disk.
+ *      - Checkpoints are written to a temporary file, flushed to disk, then renamed into place,
+ *        so a crash part way through a write never leaves a corrupt checkpoint behind.
+ *      - Only the two most recent checkpoints in the directory are kept, and the directory is flushed after each
+ *        rename so the newest one survives a crash. Checkpoints already in the directory, left by the run being
+ *        resumed, are pruned along with the new ones.
+ *      - Checkpoints are never removed on behalf of another run. A directory holds the checkpoints of one run, so
+ *        a run starting from scratch should refuse a directory that is not empty, see Checkpointer::is_empty.
+ *
+ *      - Checkpoint files (checkpoint-<generation>.ckpt) are composed of:
+ *          - the 4 byte magic "GOC2"
+ *          - 4 byte ints for the generation, total steps, toroidal flag, grid width, grid height, and the x and y
+ *            offsets of the grid, see World::get_offset_x.
+ *          - an 8 byte length followed by the run length encoded bitstream of the grid (see codec.cpp).
+ *          - an 8 byte FNV-1a checksum of everything before it.
+ *      - Checkpoints written before the offsets were added start with the magic "GOLC" and have no offsets, they
+ *        are still loaded with offsets of 0.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpoint.h"
+#include "codec.h"
+
+namespace {
+
+    /**
+     * Accumulate bytes into a 64 bit FNV-1a hash.
+     */
+    std::uint64_t fnv1a(std::uint64_t hash, const void *data, std::size_t size) {
+        const std::uint8_t *bytes = static_cast<const std::uint8_t *>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /**
+     * Parse the generation out of a checkpoint file name, or return -1 if it is not a checkpoint.
+     */
+    int checkpoint_generation(const std::string &name) {
+        const std::string prefix = "checkpoint-";
+        const std::string suffix = ".ckpt";
+
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0
+            || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            return -1;
+        }
+
+        std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        if (digits.find_first_not_of("0123456789") != std::string::npos || digits.size() > 9) {
+            return -1;
+        }
+        return std::stoi(digits);
+    }
+}
+
+/**
+ * Checkpointer::Checkpointer(checkpoint_directory)
+ *
+ * Construct a checkpointer that writes into the given directory, creating it if needed.
+ * Checkpoints already in the directory are taken to belong to the run being resumed, and are pruned as newer
+ * ones are written.
+ *
+ * @example
+ *
+ *      // Checkpoint into ./checkpoints
+ *      Checkpointer checkpointer("checkpoints");
+ *
+ * @param checkpoint_directory
+ *      The directory to write checkpoints into.
+ *
+ * @throws
+ *      std::exception or sub-class if the directory cannot be created.
+ */
+
+Checkpointer::Checkpointer(std::string checkpoint_directory) : directory(std::move(checkpoint_directory)) {
+    std::filesystem::create_directories(directory);
+
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        int generation = checkpoint_generation(entry.path().filename().string());
+        if (generation >= 0) {
+            written.push_back(generation);
+        }
+    }
+    std::sort(written.begin(), written.end());
+}
+
+/**
+ * Checkpointer::~Checkpointer()
+ *
+ * Wait for any checkpoint still being written. Errors from the final write are dropped,
+ * call Checkpointer::wait() first to observe them.
+ */
+
+Checkpointer::~Checkpointer() {
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+/**
+ * Checkpointer::save(grid, generation, steps, toroidal, offset_x = 0, offset_y = 0)
+ *
+ * Start writing a checkpoint of the grid and the simulation settings.
+ * The grid is bit-packed before returning, so the caller may keep stepping the world immediately.
+ * If the previous checkpoint is still being written this waits for it first, so at most one
+ * packed copy is ever waiting on the disk.
+ *
+ * @example
+ *
+ *      // Checkpoint the world after generation 1000 of a 5000 step toroidal run
+ *      checkpointer.save(world.get_state(), 1000, 5000, true, world.get_offset_x(), world.get_offset_y());
+ *
+ * @param grid
+ *      The grid state to save.
+ *
+ * @param generation
+ *      The number of generations simulated to reach this state.
+ *
+ * @param steps
+ *      The total number of steps the run is simulating.
+ *
+ * @param toroidal
+ *      Whether the run is simulating on a torus.
+ *
+ * @param offset_x
+ *      Optional parameter. The stable x coordinate of column 0 of the grid, see World::get_offset_x. Defaults to 0.
+ *
+ * @param offset_y
+ *      Optional parameter. The stable y coordinate of row 0 of the grid, see World::get_offset_y. Defaults to 0.
+ *
+ * @throws
+ *      std::runtime_error if the previous checkpoint failed to write.
+ */
+
+void Checkpointer::save(const Grid &grid, int generation, int steps, bool toroidal, int offset_x, int offset_y) {
+    std::vector<std::uint8_t> bits = Codec::pack_bits(grid, 0, 0, grid.get_width(), grid.get_height());
+
+    wait();
+
+    writer = std::thread(&Checkpointer::write, this, std::move(bits), grid.get_width(), grid.get_height(),
+                         offset_x, offset_y, generation, steps, toroidal);
+}
+
+/**
+ * Checkpointer::wait()
+ *
+ * Block until the checkpoint currently being written, if any, is safely on disk.
+ *
+ * @throws
+ *      std::runtime_error if the checkpoint failed to write.
+ */
+
+void Checkpointer::wait() {
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!error.empty()) {
+        std::string message = error;
+        error.clear();
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * Checkpointer::is_empty()
+ *
+ * Checks if the directory holds no checkpoints. Call it before the first save, whose checkpoint would count.
+ *
+ * @example
+ *
+ *      // Never start a fresh run over another run's checkpoints
+ *      Checkpointer checkpointer("checkpoints");
+ *      if (!checkpointer.is_empty()) {
+ *          throw std::runtime_error("Directory already holds checkpoints.");
+ *      }
+ *
+ * @return
+ *      True if the directory held no checkpoints.
+ */
+
+bool Checkpointer::is_empty() const {
+    return written.empty();
+}
+
+/**
+ * Checkpointer::write(bits, width, height, offset_x, offset_y, generation, steps, toroidal)
+ *
+ * Private body of the background writer thread.
+ * Compresses the packed grid, writes it to a temporary file, flushes it to disk, and renames it into place.
+ * Failures are recorded and reported by the next call to Checkpointer::wait().
+ */
+
+void Checkpointer::write(std::vector<std::uint8_t> bits, int width, int height, int offset_x, int offset_y,
+                         int generation, int steps, bool toroidal) {
+    std::string name = directory + "/checkpoint-" + std::to_string(generation) + ".ckpt";
+    std::string temporary = name + ".tmp";
+
+    try {
+        std::vector<std::uint8_t> compressed = Codec::rle_encode(bits);
+        bits.clear();
+        bits.shrink_to_fit();
+
+        std::vector<std::uint8_t> buffer;
+        auto append = [&buffer](const void *data, std::size_t size) {
+            const std::uint8_t *bytes = static_cast<const std::uint8_t *>(data);
+            buffer.insert(buffer.end(), bytes, bytes + size);
+        };
+
+        int flag = toroidal ? 1 : 0;
+        std::uint64_t length = compressed.size();
+
+        append("GOC2", 4);
+        append(&generation, 4);
+        append(&steps, 4);
+        append(&flag, 4);
+        append(&width, 4);
+        append(&height, 4);
+        append(&offset_x, 4);
+        append(&offset_y, 4);
+        append(&length, 8);
+
+        std::uint64_t checksum = fnv1a(1469598103934665603ULL, buffer.data(), buffer.size());
+        checksum = fnv1a(checksum, compressed.data(), compressed.size());
+
+        // Write with POSIX calls so the data can be fsync'd before the rename makes it visible.
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open checkpoint file " + temporary);
+        }
+
+        auto write_all = [fd, &temporary](const std::uint8_t *data, std::size_t size) {
+            while (size > 0) {
+                ssize_t written = ::write(fd, data, size);
+                if (written < 0) {
+                    ::close(fd);
+                    throw std::runtime_error("Failed to write checkpoint file " + temporary);
+                }
+                data += written;
+                size -= std::size_t(written);
+            }
+        };
+
+        write_all(buffer.data(), buffer.size());
+        write_all(compressed.data(), compressed.size());
+        write_all(reinterpret_cast<const std::uint8_t *>(&checksum), 8);
+
+        int synced = ::fsync(fd);
+        if (::close(fd) != 0 || synced != 0) {
+            throw std::runtime_error("Failed to flush checkpoint file " + temporary);
+        }
+
+        std::filesystem::rename(temporary, name);
+
+        // The rename is only durable once the directory entry itself is flushed
+        int directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (directory_fd < 0) {
+            throw std::runtime_error("Cannot open checkpoint directory " + directory);
+        }
+        synced = ::fsync(directory_fd);
+        if (::close(directory_fd) != 0 || synced != 0) {
+            throw std::runtime_error("Failed to flush checkpoint directory " + directory);
+        }
+
+        // Keep the new checkpoint and the one before it, in case the newest is lost
+        written.erase(std::remove(written.begin(), written.end(), generation), written.end());
+        written.push_back(generation);
+        while (written.size() > 2) {
+            std::filesystem::remove(directory + "/checkpoint-" + std::to_string(written.front()) + ".ckpt");
+            written.erase(written.begin());
+        }
+    }
+    catch (const std::exception &ex) {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+
+        std::lock_guard<std::mutex> lock(error_mutex);
+        error = ex.what();
+    }
+}
+
+/**
+ * Checkpointer::load_latest(checkpoint_directory, grid, generation, steps, toroidal, offset_x, offset_y)
+ *
+ * Load the most recent valid checkpoint from a directory.
+ * Checkpoints are tried newest first, skipping any that are truncated or fail their checksum.
+ *
+ * @example
+ *
+ *      Grid grid;
+ *      int generation, steps, offset_x, offset_y;
+ *      bool toroidal;
+ *
+ *      if (Checkpointer::load_latest("checkpoints", grid, generation, steps, toroidal, offset_x, offset_y)) {
+ *          World world(grid);
+ *          world.set_offset(offset_x, offset_y);
+ *          world.advance(steps - generation, toroidal);
+ *      }
+ *
+ * @param checkpoint_directory
+ *      The directory to search for checkpoints.
+ *
+ * @param grid
+ *      Set to the saved grid state.
+ *
+ * @param generation
+ *      Set to the saved generation counter.
+ *
+ * @param steps
+ *      Set to the saved total number of steps.
+ *
+ * @param toroidal
+ *      Set to the saved toroidal setting.
+ *
+ * @param offset_x
+ *      Set to the saved x offset of the grid, 0 for checkpoints written without one.
+ *
+ * @param offset_y
+ *      Set to the saved y offset of the grid, 0 for checkpoints written without one.
+ *
+ * @return
+ *      True if a valid checkpoint was found and loaded, false otherwise.
+ */
+
+bool Checkpointer::load_latest(const std::string &checkpoint_directory, Grid &grid, int &generation, int &steps,
+                               bool &toroidal, int &offset_x, int &offset_y) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(checkpoint_directory, ec)) {
+        return false;
+    }
+
+    std::vector<int> generations;
+    for (const auto &entry : std::filesystem::directory_iterator(checkpoint_directory)) {
+        int other = checkpoint_generation(entry.path().filename().string());
+        if (other >= 0) {
+            generations.push_back(other);
+        }
+    }
+    std::sort(generations.rbegin(), generations.rend());
+
+    for (int candidate : generations) {
+        std::ifstream in_file(checkpoint_directory + "/checkpoint-" + std::to_string(candidate) + ".ckpt",
+                              std::ios::binary);
+
+        // The fields are generation, steps, toroidal, width, height, then the offsets if the magic is GOC2
+        char header[40];
+        if (!in_file.read(header, 4)) {
+            continue;
+        }
+        const std::string magic(header, 4);
+        const std::size_t size = magic == "GOC2" ? 40 : 32;
+        if ((magic != "GOC2" && magic != "GOLC") || !in_file.read(header + 4, std::streamsize(size - 4))) {
+            continue;
+        }
+
+        int fields[7] = {};
+        std::uint64_t length;
+        std::copy(header + 4, header + size - 8, reinterpret_cast<char *>(fields));
+        std::copy(header + size - 8, header + size, reinterpret_cast<char *>(&length));
+
+        if (fields[3] < 0 || fields[4] < 0 || length > (std::uint64_t(fields[3]) * fields[4] / 8 + 1) * 2 + 16) {
+            continue;
+        }
+
+        std::vector<std::uint8_t> compressed(length);
+        std::uint64_t checksum;
+        if (!in_file.read(reinterpret_cast<char *>(compressed.data()), std::streamsize(length))
+            || !in_file.read(reinterpret_cast<char *>(&checksum), 8)) {
+            continue;
+        }
+
+        std::uint64_t expected = fnv1a(1469598103934665603ULL, header, size);
+        expected = fnv1a(expected, compressed.data(), compressed.size());
+        if (checksum != expected) {
+            continue;
+        }
+
+        try {
+            Grid loaded(fields[3], fields[4]);
+            Codec::unpack_bits(Codec::rle_decode(compressed, (std::size_t(fields[3]) * fields[4] + 7) / 8),
+                               fields[3], fields[4], loaded, 0, 0);
+            grid = std::move(loaded);
+        }
+        catch (const std::exception &) {
+            continue;
+        }
+
+        generation = fields[0];
+        steps = fields[1];
+        toroidal = fields[2] != 0;
+        offset_x = fields[5];
+        offset_y = fields[6];
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,52 @@
+/**
+ * Declares a class for writing crash-safe checkpoints of a running simulation on a background thread.
+ * Rich documentation for the api and behaviour the Checkpointer class can be found in checkpoint.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the structure of the Checkpointer class for saving and restoring simulation state.
+ *
+ * A Checkpointer owns at most one background writer thread at a time.
+ */
+class Checkpointer {
+
+private:
+    std::string directory;
+    std::thread writer;
+    std::vector<int> written;
+
+    std::mutex error_mutex;
+    std::string error;
+
+    void write(std::vector<std::uint8_t> bits, int width, int height, int offset_x, int offset_y, int generation,
+               int steps, bool toroidal);
+
+public:
+    explicit Checkpointer(std::string checkpoint_directory);
+
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer &) = delete;
+
+    Checkpointer &operator=(const Checkpointer &) = delete;
+
+    void save(const Grid &grid, int generation, int steps, bool toroidal, int offset_x = 0, int offset_y = 0);
+
+    void wait();
+
+    bool is_empty() const;
+
+    static bool load_latest(const std::string &checkpoint_directory, Grid &grid, int &generation, int &steps,
+                            bool &toroidal, int &offset_x, int &offset_y);
+};
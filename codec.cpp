@@ -0,0 +1,302 @@
+/**
+ * Implements a Codec namespace with helpers shared by the compressed file formats.
+ *      - Rectangular regions of a grid can be packed into a bitstream and unpacked again.
+ *          - Cells are stored in C-style row/column format, one bit per cell, least significant bit first,
+ *            matching the body of the binary .bgol format.
+ *          - A 0 bit is Cell::DEAD, a 1 bit is Cell::ALIVE.
+ *
+ *      - Byte streams can be compressed with a simple run length encoding.
+ *          - A control byte n below 128 is followed by n + 1 literal bytes.
+ *          - A control byte n of 128 or above is followed by one byte repeated (n - 125) times.
+ *
+ *      - Unsigned integers can be written as variable length integers.
+ *          - 7 bits per byte, least significant group first, the high bit set on every byte but the last.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <stdexcept>
+#include "codec.h"
+
+/**
+ * Codec::pack_bits(grid, x0, y0, x1, y1)
+ *
+ * Pack the cells of the region [x0, x1) by [y0, y1) of a grid into a bitstream.
+ * The last byte is padded with 0 bits.
+ *
+ * @example
+ *
+ *      // Pack a whole grid
+ *      std::vector<std::uint8_t> bits = Codec::pack_bits(grid, 0, 0, grid.get_width(), grid.get_height());
+ *
+ * @param grid
+ *      The grid, or view of a grid, to read from.
+ *
+ * @param x0
+ *      Left coordinate of the region on x-axis.
+ *
+ * @param y0
+ *      Top coordinate of the region on y-axis.
+ *
+ * @param x1
+ *      Right coordinate of the region on x-axis (1 greater than the largest index).
+ *
+ * @param y1
+ *      Bottom coordinate of the region on y-axis (1 greater than the largest index).
+ *
+ * @return
+ *      The packed bits of the region.
+ *
+ * @throws
+ *      std::exception or sub-class if the region is not within the grid.
+ */
+
+std::vector<std::uint8_t> Codec::pack_bits(ConstGridView grid, int x0, int y0, int x1, int y1) {
+
+    if (x0 < 0 || y0 < 0 || x1 > grid.get_width() || y1 > grid.get_height() || x1 < x0 || y1 < y0) {
+        throw std::range_error("Region is not in the required ranges.");
+    }
+
+    std::size_t width = std::size_t(x1 - x0);
+    std::size_t height = std::size_t(y1 - y0);
+    std::vector<std::uint8_t> bits((width * height + 7) / 8, 0);
+
+    std::size_t index = 0;
+    for (int y = y0; y < y1; ++y) {
+        const Cell *cells = grid.row(y);
+        for (int x = x0; x < x1; ++x, ++index) {
+            bits[index / 8] |= std::uint8_t((cells[x] == Cell::ALIVE) << (index % 8));
+        }
+    }
+    return bits;
+}
+
+/**
+ * Codec::unpack_bits(bits, width, height, grid, x0, y0)
+ *
+ * Unpack a width by height bitstream produced by Codec::pack_bits into a grid,
+ * placing its top left corner at x0, y0. Cells of the bitstream that fall outside the grid are skipped,
+ * so a bitstream can be clipped against a smaller destination.
+ *
+ * @example
+ *
+ *      // Unpack a 16x16 tile so that its top left corner lands 4 cells outside the grid
+ *      Codec::unpack_bits(bits, 16, 16, grid, -4, -4);
+ *
+ * @param bits
+ *      The packed bits.
+ *
+ * @param width
+ *      The width of the packed region.
+ *
+ * @param height
+ *      The height of the packed region.
+ *
+ * @param grid
+ *      The grid to write into.
+ *
+ * @param x0
+ *      The x coordinate in the grid of the top left corner of the packed region.
+ *
+ * @param y0
+ *      The y coordinate in the grid of the top left corner of the packed region.
+ *
+ * @throws
+ *      std::exception or sub-class if the bitstream is too short for the region.
+ */
+
+void Codec::unpack_bits(const std::vector<std::uint8_t> &bits, int width, int height, Grid &grid, int x0, int y0) {
+
+    if (bits.size() * 8 < std::size_t(width) * std::size_t(height)) {
+        throw std::invalid_argument("Malformed bitstream.");
+    }
+
+    int first_x = std::max(0, -x0);
+    int first_y = std::max(0, -y0);
+    int last_x = std::min(width, grid.get_width() - x0);
+    int last_y = std::min(height, grid.get_height() - y0);
+
+    for (int y = first_y; y < last_y; ++y) {
+        std::size_t index = std::size_t(y) * width + first_x;
+        for (int x = first_x; x < last_x; ++x, ++index) {
+            grid(x0 + x, y0 + y) = ((bits[index / 8] >> (index % 8)) & 1) ? Cell::ALIVE : Cell::DEAD;
+        }
+    }
+}
+
+/**
+ * Codec::rle_encode(bytes)
+ *
+ * Compress a byte stream with run length encoding.
+ * Runs of 3 or more equal bytes are stored as a repeat, everything else is stored as literals.
+ *
+ * @example
+ *
+ *      std::vector<std::uint8_t> compressed = Codec::rle_encode(Codec::pack_bits(grid, 0, 0, 8, 8));
+ *
+ * @param bytes
+ *      The bytes to compress.
+ *
+ * @return
+ *      The compressed bytes.
+ */
+
+std::vector<std::uint8_t> Codec::rle_encode(const std::vector<std::uint8_t> &bytes) {
+
+    std::vector<std::uint8_t> encoded;
+    encoded.reserve(bytes.size() / 4 + 16);
+
+    std::size_t i = 0;
+    while (i < bytes.size()) {
+
+        // Measure the run starting at i.
+        std::size_t run = 1;
+        while (i + run < bytes.size() && run < 130 && bytes[i + run] == bytes[i]) {
+            run++;
+        }
+
+        if (run >= 3) {
+            encoded.push_back(std::uint8_t(125 + run));
+            encoded.push_back(bytes[i]);
+            i += run;
+            continue;
+        }
+
+        // Collect literals until the next run of 3 or the literal limit.
+        std::size_t start = i;
+        while (i < bytes.size() && i - start < 128) {
+            if (i + 2 < bytes.size() && bytes[i] == bytes[i + 1] && bytes[i] == bytes[i + 2]) {
+                break;
+            }
+            i++;
+        }
+
+        encoded.push_back(std::uint8_t(i - start - 1));
+        encoded.insert(encoded.end(), bytes.begin() + start, bytes.begin() + i);
+    }
+    return encoded;
+}
+
+/**
+ * Codec::rle_decode(bytes, expected_size)
+ *
+ * Decompress a byte stream produced by Codec::rle_encode.
+ *
+ * @example
+ *
+ *      std::vector<std::uint8_t> bits = Codec::rle_decode(compressed, 8);
+ *
+ * @param bytes
+ *      The compressed bytes.
+ *
+ * @param expected_size
+ *      The number of bytes the stream must decompress to.
+ *
+ * @return
+ *      The decompressed bytes.
+ *
+ * @throws
+ *      std::exception or sub-class if the stream is truncated or does not decompress to expected_size bytes.
+ */
+
+std::vector<std::uint8_t> Codec::rle_decode(const std::vector<std::uint8_t> &bytes, std::size_t expected_size) {
+
+    std::vector<std::uint8_t> decoded;
+    decoded.reserve(expected_size);
+
+    std::size_t i = 0;
+    while (i < bytes.size()) {
+        std::uint8_t control = bytes[i++];
+
+        if (control >= 128) {
+            if (i >= bytes.size()) {
+                throw std::invalid_argument("Malformed run length encoding.");
+            }
+            decoded.insert(decoded.end(), std::size_t(control) - 125, bytes[i++]);
+        } else {
+            std::size_t count = std::size_t(control) + 1;
+            if (i + count > bytes.size()) {
+                throw std::invalid_argument("Malformed run length encoding.");
+            }
+            decoded.insert(decoded.end(), bytes.begin() + i, bytes.begin() + i + count);
+            i += count;
+        }
+
+        if (decoded.size() > expected_size) {
+            throw std::invalid_argument("Malformed run length encoding.");
+        }
+    }
+
+    if (decoded.size() != expected_size) {
+        throw std::invalid_argument("Malformed run length encoding.");
+    }
+    return decoded;
+}
+
+/**
+ * Codec::put_varint(bytes, value)
+ *
+ * Append an unsigned integer to a byte stream as a variable length integer.
+ * Values below 128 take a single byte.
+ *
+ * @example
+ *
+ *      std::vector<std::uint8_t> bytes;
+ *      Codec::put_varint(bytes, 300);
+ *
+ * @param bytes
+ *      The byte stream to append to.
+ *
+ * @param value
+ *      The value to append.
+ */
+
+void Codec::put_varint(std::vector<std::uint8_t> &bytes, std::uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(std::uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(std::uint8_t(value));
+}
+
+/**
+ * Codec::get_varint(bytes, position)
+ *
+ * Read a variable length integer written by Codec::put_varint, advancing position past it.
+ *
+ * @example
+ *
+ *      std::size_t position = 0;
+ *      std::uint64_t value = Codec::get_varint(bytes, position);
+ *
+ * @param bytes
+ *      The byte stream to read from.
+ *
+ * @param position
+ *      The offset of the integer in the stream, updated to the offset of the next byte.
+ *
+ * @return
+ *      The decoded value.
+ *
+ * @throws
+ *      std::exception or sub-class if the stream ends part way through the integer.
+ */
+
+std::uint64_t Codec::get_varint(const std::vector<std::uint8_t> &bytes, std::size_t &position) {
+    std::uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (position >= bytes.size()) {
+            throw std::invalid_argument("Malformed variable length integer.");
+        }
+
+        std::uint8_t byte = bytes[position++];
+        value |= std::uint64_t(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::invalid_argument("Malformed variable length integer.");
+}
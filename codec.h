@@ -0,0 +1,29 @@
+/**
+ * Declares a Codec namespace with helpers for packing grids into bits and compressing byte streams.
+ * Rich documentation for the api and behaviour the Codec namespace can be found in codec.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the interface of the Codec namespace shared by the compressed file formats.
+ */
+namespace Codec {
+    std::vector<std::uint8_t> pack_bits(ConstGridView grid, int x0, int y0, int x1, int y1);
+
+    void unpack_bits(const std::vector<std::uint8_t> &bits, int width, int height, Grid &grid, int x0, int y0);
+
+    std::vector<std::uint8_t> rle_encode(const std::vector<std::uint8_t> &bytes);
+
+    std::vector<std::uint8_t> rle_decode(const std::vector<std::uint8_t> &bytes, std::size_t expected_size);
+
+    void put_varint(std::vector<std::uint8_t> &bytes, std::uint64_t value);
+
+    std::uint64_t get_varint(const std::vector<std::uint8_t> &bytes, std::size_t &position);
+};
@@ -0,0 +1,620 @@
+/**
+ * Implements the Engine interface registry and the built-in stepping engines.
+ *      - Engines step a current grid into a next grid under the same rules and edge behaviour as World::step.
+ *          - The next grid is resized to match the current grid if needed and every cell is written.
+ *
+ *      - Engines are created by name from a registry, new engines can be added with Engine::add.
+ *          - A name may carry a numeric parameter after a colon, such as threaded:4, which is passed to the factory.
+ *          - naive     Counts the 8 neighbours of every cell, the simplest correct engine.
+ *          - rowsum    Sums each column of 3 cells once per row, then slides a 3 wide window along those sums.
+ *          - threaded  The rowsum engine with the rows split into bands, the parameter is the number of threads
+ *                      and defaults to one per hardware thread.
+ *
+ *      - Engine::tune times every candidate engine, and World::step itself as reference, on a copy of the actual
+ *        state and returns the fastest. Decisions are cached per machine in a small profile file keyed by the
+ *        size, density and topology of the state and the number of hardware threads:
+ *          - $XDG_CACHE_HOME/game_of_life/engines, or ~/.cache/game_of_life/engines.
+ *          - One "key engine" pair per line. Without either variable nothing is cached.
+ *
+ *      - Engine::validate runs an engine in lockstep with World::step on random soups and Zoo patterns, bounded
+ *        and toroidal. The first divergence is reported with its generation and region, and both versions of the
+ *        region are saved as .gol files.
+ *
+ *      - On a torus neighbours wrap with modular arithmetic, so on grids 1 or 2 cells across a neighbour may be
+ *        counted more than once, exactly as World::count_neighbours does.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+#include "engine.h"
+#include "world.h"
+#include "zoo.h"
+
+namespace {
+
+    /**
+     * alive(cell)
+     *
+     * 1 for an alive cell and 0 for a dead one. Cell::ALIVE '#' is odd and Cell::DEAD ' ' is even,
+     * so this is branch-free and vectorizes.
+     */
+
+    inline int alive(Cell cell) {
+        return cell & 1;
+    }
+
+    /**
+     * rule(neighbours, cell)
+     *
+     * The state of a cell in the next generation.
+     */
+
+    inline Cell rule(int neighbours, Cell cell) {
+        return (neighbours == 3 || (neighbours == 2 && cell == Cell::ALIVE)) ? Cell::ALIVE : Cell::DEAD;
+    }
+
+    /**
+     * step_band(current, next, toroidal, y0, y1)
+     *
+     * The rowsum kernel over the rows [y0, y1). For each row the three cells above, on and below every column
+     * are summed once, then each cell adds the sums of its own and its two neighbouring columns.
+     */
+
+    void step_band(const Grid &current, Grid &next, bool toroidal, int y0, int y1) {
+        const int width = current.get_width();
+        const int height = current.get_height();
+        std::vector<unsigned char> sums(width + 2);
+
+        for (int y = y0; y < y1; ++y) {
+            const Cell *middle = current.row(y);
+            const Cell *above = nullptr;
+            const Cell *below = nullptr;
+            if (toroidal) {
+                above = current.row((y - 1 + height) % height);
+                below = current.row((y + 1) % height);
+            } else {
+                above = y > 0 ? current.row(y - 1) : nullptr;
+                below = y + 1 < height ? current.row(y + 1) : nullptr;
+            }
+
+            for (int x = 0; x < width; ++x) {
+                sums[x + 1] = (unsigned char) ((above ? alive(above[x]) : 0) + alive(middle[x])
+                                               + (below ? alive(below[x]) : 0));
+            }
+            sums[0] = toroidal ? sums[width] : 0;
+            sums[width + 1] = toroidal ? sums[1] : 0;
+
+            Cell *row = next.row(y);
+            for (int x = 0; x < width; ++x) {
+                int neighbours = sums[x] + sums[x + 1] + sums[x + 2] - alive(middle[x]);
+                row[x] = rule(neighbours, middle[x]);
+            }
+        }
+    }
+
+    /**
+     * match_size(current, next)
+     *
+     * Resize the next grid to the size of the current grid if they differ.
+     */
+
+    void match_size(const Grid &current, Grid &next) {
+        if (next.get_width() != current.get_width() || next.get_height() != current.get_height()) {
+            next = Grid(current.get_width(), current.get_height());
+        }
+    }
+
+    /**
+     * Counts the 8 neighbours of every cell.
+     */
+    class NaiveEngine : public Engine {
+    public:
+        std::string get_name() const override {
+            return "naive";
+        }
+
+        void step(const Grid &current, Grid &next, bool toroidal) override {
+            match_size(current, next);
+            const int width = current.get_width();
+            const int height = current.get_height();
+
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    int neighbours = 0;
+                    for (int dy = -1; dy <= 1; ++dy) {
+                        for (int dx = -1; dx <= 1; ++dx) {
+                            int nx = x + dx;
+                            int ny = y + dy;
+                            if (toroidal) {
+                                nx = (nx + width) % width;
+                                ny = (ny + height) % height;
+                            } else if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+                                continue;
+                            }
+                            neighbours += alive(current(nx, ny));
+                        }
+                    }
+                    next(x, y) = rule(neighbours - alive(current(x, y)), current(x, y));
+                }
+            }
+        }
+    };
+
+    /**
+     * Sums columns of 3 cells once per row and slides a window along them.
+     */
+    class RowsumEngine : public Engine {
+    public:
+        std::string get_name() const override {
+            return "rowsum";
+        }
+
+        void step(const Grid &current, Grid &next, bool toroidal) override {
+            match_size(current, next);
+            step_band(current, next, toroidal, 0, current.get_height());
+        }
+    };
+
+    /**
+     * The rowsum kernel with the rows split into bands stepped on separate threads.
+     */
+    class ThreadedEngine : public Engine {
+    private:
+        int threads;
+
+    public:
+        explicit ThreadedEngine(int threads) : threads(std::max(1, threads)) {}
+
+        std::string get_name() const override {
+            return "threaded:" + std::to_string(threads);
+        }
+
+        void step(const Grid &current, Grid &next, bool toroidal) override {
+            match_size(current, next);
+            const int height = current.get_height();
+            const int bands = std::max(1, std::min(threads, height));
+
+            std::vector<std::thread> workers;
+            for (int band = 1; band < bands; ++band) {
+                workers.emplace_back(step_band, std::cref(current), std::ref(next), toroidal,
+                                     int((long long) height * band / bands),
+                                     int((long long) height * (band + 1) / bands));
+            }
+            step_band(current, next, toroidal, 0, height / bands);
+            for (std::thread &worker : workers) {
+                worker.join();
+            }
+        }
+    };
+
+    /**
+     * registry()
+     *
+     * The registered engine factories by name, created with the built-in engines on first use.
+     */
+
+    std::map<std::string, Engine::Factory> &registry() {
+        static std::map<std::string, Engine::Factory> factories = {
+                {"naive",    [](int) { return std::unique_ptr<Engine>(new NaiveEngine()); }},
+                {"rowsum",   [](int) { return std::unique_ptr<Engine>(new RowsumEngine()); }},
+                {"threaded", [](int threads) {
+                    return std::unique_ptr<Engine>(new ThreadedEngine(
+                            threads > 0 ? threads : int(std::thread::hardware_concurrency())));
+                }}
+        };
+        return factories;
+    }
+
+    /**
+     * A named starting grid for validation.
+     */
+    struct Case {
+        std::string name;
+        Grid grid;
+    };
+
+    /**
+     * validation_cases(seed)
+     *
+     * Random soups of several sizes and densities, including degenerate 1 and 2 cell wide grids, and Zoo
+     * patterns placed so they run into the edges.
+     */
+
+    std::vector<Case> validation_cases(unsigned seed) {
+        std::vector<Case> cases;
+        std::mt19937 rng(seed);
+
+        const int sizes[][2] = {{1, 1}, {2, 2}, {1, 5}, {5, 1}, {2, 7}, {3, 3}, {7, 4}, {16, 16}, {37, 23},
+                                {64, 64}, {130, 70}};
+        for (const auto &size : sizes) {
+            for (double density : {0.2, 0.35, 0.5}) {
+                Grid grid(size[0], size[1]);
+                for (int y = 0; y < size[1]; ++y) {
+                    for (int x = 0; x < size[0]; ++x) {
+                        grid(x, y) = rng() < std::uint32_t(density * 4294967295.0) ? Cell::ALIVE : Cell::DEAD;
+                    }
+                }
+                cases.push_back({"soup " + std::to_string(size[0]) + "x" + std::to_string(size[1]) + " density "
+                                 + std::to_string(density).substr(0, 4), grid});
+            }
+        }
+
+        const std::pair<std::string, Grid> patterns[] = {{"glider",                 Zoo::glider()},
+                                                         {"r_pentomino",            Zoo::r_pentomino()},
+                                                         {"light_weight_spaceship", Zoo::light_weight_spaceship()}};
+        for (const auto &pattern : patterns) {
+            for (int rotation = 0; rotation < 4; ++rotation) {
+                Grid shape = pattern.second.rotate(rotation);
+                Grid grid(40, 30);
+                grid.merge(shape, 1, 1, true);
+                grid.merge(shape, 40 - shape.get_width() - 1, 30 - shape.get_height() - 1, true);
+                grid.merge(shape, 20, 15, true);
+                cases.push_back({pattern.first + " rotated " + std::to_string(rotation), grid});
+            }
+        }
+        return cases;
+    }
+
+    /**
+     * profile_path()
+     *
+     * The path of the machine profile of tuned engines, empty if there is nowhere to keep it.
+     */
+
+    std::string profile_path() {
+        const char *cache = std::getenv("XDG_CACHE_HOME");
+        const char *home = std::getenv("HOME");
+        if (cache != nullptr && *cache != '\0') {
+            return std::string(cache) + "/game_of_life/engines";
+        }
+        if (home != nullptr && *home != '\0') {
+            return std::string(home) + "/.cache/game_of_life/engines";
+        }
+        return "";
+    }
+
+    /**
+     * read_profile(path)
+     *
+     * The key and engine pairs in a profile, a missing or unreadable profile is empty.
+     */
+
+    std::map<std::string, std::string> read_profile(const std::string &path) {
+        std::map<std::string, std::string> profile;
+        std::ifstream file(path);
+        std::string key;
+        std::string engine;
+        while (file >> key >> engine) {
+            profile[key] = engine;
+        }
+        return profile;
+    }
+
+    /**
+     * write_profile(path, profile)
+     *
+     * Replace a profile with new contents. The profile is only a cache, so failing to write it is not an error.
+     * Each write goes through its own temporary file, so tunes running at once in other threads or processes
+     * never write into the same file, and the last rename wins.
+     */
+
+    void write_profile(const std::string &path, const std::map<std::string, std::string> &profile) {
+        if (path.empty()) {
+            return;
+        }
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+        static std::atomic<unsigned> writes(0);
+        const std::string temporary = path + "." + std::to_string(getpid()) + "." + std::to_string(writes++) + ".tmp";
+        {
+            std::ofstream file(temporary);
+            for (const auto &entry : profile) {
+                file << entry.first << ' ' << entry.second << '\n';
+            }
+            if (!file) {
+                file.close();
+                std::filesystem::remove(temporary, error);
+                return;
+            }
+        }
+        std::filesystem::rename(temporary, path, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+        }
+    }
+}
+
+/**
+ * Engine::add(name, factory)
+ *
+ * Register an engine so it can be created by name, replacing any engine already registered with that name.
+ *
+ * @example
+ *
+ *      // Register a new engine
+ *      Engine::add("mine", [](int) { return std::unique_ptr<Engine>(new MyEngine()); });
+ *
+ * @param name
+ *      The name to register the engine under.
+ *
+ * @param factory
+ *      A function making a new instance of the engine from the parameter in its name, 0 if none was given.
+ */
+
+void Engine::add(const std::string &name, Factory factory) {
+    registry()[name] = std::move(factory);
+}
+
+/**
+ * Engine::create(name)
+ *
+ * Create a new instance of a registered engine.
+ *
+ * @example
+ *
+ *      // Step a grid with the rowsum engine
+ *      std::unique_ptr<Engine> engine = Engine::create("rowsum");
+ *      engine->step(current, next, false);
+ *
+ * @param name
+ *      The name the engine was registered under, optionally followed by a colon and a positive parameter.
+ *
+ * @return
+ *      Returns the new engine.
+ *
+ * @throws
+ *      std::invalid_argument if no engine is registered with the name or the parameter is not a positive integer.
+ */
+
+std::unique_ptr<Engine> Engine::create(const std::string &name) {
+    std::size_t colon = name.find(':');
+    int parameter = 0;
+    if (colon != std::string::npos) {
+        try {
+            parameter = std::stoi(name.substr(colon + 1));
+        }
+        catch (const std::exception &) {
+            throw std::invalid_argument("Engine not valid.");
+        }
+        if (parameter <= 0) {
+            throw std::invalid_argument("Engine not valid.");
+        }
+    }
+
+    auto found = registry().find(name.substr(0, colon));
+    if (found == registry().end()) {
+        throw std::invalid_argument("Engine not valid.");
+    }
+    return found->second(parameter);
+}
+
+/**
+ * Engine::get_names()
+ *
+ * Gets the names of every registered engine.
+ *
+ * @return
+ *      The registered names in alphabetical order.
+ */
+
+std::vector<std::string> Engine::get_names() {
+    std::vector<std::string> names;
+    for (const auto &entry : registry()) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+/**
+ * Engine::get_candidates()
+ *
+ * Gets the engine configurations Engine::tune chooses between.
+ * These are "reference" for World::step itself and every registered engine except naive, with the threaded
+ * engine tried at each power of two threads below the hardware thread count and at the hardware thread count.
+ * Threaded engines are left out on a single hardware thread.
+ *
+ * @return
+ *      The names of the candidates, each can be passed to World::set_engine.
+ */
+
+std::vector<std::string> Engine::get_candidates() {
+    std::vector<std::string> candidates = {"reference"};
+    const int hardware = int(std::thread::hardware_concurrency());
+
+    for (const std::string &name : get_names()) {
+        if (name == "naive") {
+            continue;
+        }
+        if (name == "threaded") {
+            for (int threads = 2; threads < hardware; threads *= 2) {
+                candidates.push_back("threaded:" + std::to_string(threads));
+            }
+            if (hardware > 1) {
+                candidates.push_back("threaded:" + std::to_string(hardware));
+            }
+            continue;
+        }
+        candidates.push_back(name);
+    }
+    return candidates;
+}
+
+/**
+ * Engine::tune(state, toroidal)
+ *
+ * Choose the fastest engine for stepping a state.
+ * Each of Engine::get_candidates is timed over a few generations from a copy of the state, the state itself is
+ * not changed. The choice is cached in the machine profile under a key made from the size and density of the
+ * state, the topology and the hardware thread count, so later runs with a similar workload skip the timing.
+ *
+ * @example
+ *
+ *      // Pick an engine for a world
+ *      std::string choice = Engine::tune(world.get_state(), false);
+ *
+ * @param state
+ *      The grid the engine will step.
+ *
+ * @param toroidal
+ *      If true then the engine will step the grid as a torus.
+ *
+ * @return
+ *      Returns the name of the fastest candidate, "reference" if World::step itself was fastest.
+ */
+
+std::string Engine::tune(const Grid &state, bool toroidal) {
+    const long long cells = std::max(1LL, (long long) state.get_width() * state.get_height());
+    int size_bucket = 0;
+    while ((1LL << size_bucket) < cells) {
+        size_bucket++;
+    }
+    const int density_bucket = int(20.0 * state.get_alive_cells() / cells);
+    const std::string key = "cells=2^" + std::to_string(size_bucket) + ",density=" + std::to_string(density_bucket)
+                            + "/20,toroidal=" + (toroidal ? "1" : "0")
+                            + ",threads=" + std::to_string(std::thread::hardware_concurrency());
+
+    const std::string path = profile_path();
+    std::map<std::string, std::string> profile = read_profile(path);
+    std::vector<std::string> candidates = get_candidates();
+
+    auto cached = profile.find(key);
+    if (cached != profile.end() &&
+        std::find(candidates.begin(), candidates.end(), cached->second) != candidates.end()) {
+        return cached->second;
+    }
+
+    // Long enough to see past the first step's allocations, short enough not to delay the start of a run
+    const int generations = int(std::min(8LL, std::max(2LL, (1LL << 22) / cells)));
+
+    std::string best;
+    double best_seconds = 0;
+    for (const std::string &candidate : candidates) {
+        double seconds;
+        if (candidate == "reference") {
+            World world(state);
+            auto start = std::chrono::steady_clock::now();
+            world.advance(generations, toroidal);
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } else {
+            std::unique_ptr<Engine> engine = create(candidate);
+            Grid current = state;
+            Grid next;
+            auto start = std::chrono::steady_clock::now();
+            for (int generation = 0; generation < generations; ++generation) {
+                engine->step(current, next, toroidal);
+                std::swap(current, next);
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (best.empty() || seconds < best_seconds) {
+            best = candidate;
+            best_seconds = seconds;
+        }
+    }
+
+    profile[key] = best;
+    write_profile(path, profile);
+    return best;
+}
+
+/**
+ * Engine::validate(name, report, seed = 42, generations = 200)
+ *
+ * Run an engine in lockstep with World::step and check every generation is identical.
+ * Each validation case is run bounded and toroidal. On the first divergence the case, mode, generation and
+ * the region of differing cells, expanded by one cell, are written to the report, and the region is saved
+ * from both the reference and the engine as validate-<name>-expected.gol and validate-<name>-actual.gol.
+ *
+ * @example
+ *
+ *      // Check the threaded engine before using it
+ *      if (!Engine::validate("threaded", std::cout)) {
+ *          std::exit(1);
+ *      }
+ *
+ * @param name
+ *      The name of the engine to validate.
+ *
+ * @param report
+ *      The stream to write progress and any divergence to.
+ *
+ * @param seed
+ *      Optional parameter. The seed for the random soups. Defaults to 42.
+ *
+ * @param generations
+ *      Optional parameter. The number of generations to run each case for. Defaults to 200.
+ *
+ * @return
+ *      Returns true if the engine matched World::step on every generation of every case.
+ *
+ * @throws
+ *      std::invalid_argument if no engine is registered with the name.
+ */
+
+bool Engine::validate(const std::string &name, std::ostream &report, unsigned seed, int generations) {
+    std::unique_ptr<Engine> engine = create(name);
+    std::vector<Case> cases = validation_cases(seed);
+
+    report << "Validating " << name << " against World::step on " << cases.size() << " cases..." << std::endl;
+
+    for (const Case &test : cases) {
+        for (bool toroidal : {false, true}) {
+            World reference(test.grid);
+            Grid current = test.grid;
+            Grid next;
+
+            for (int generation = 1; generation <= generations; ++generation) {
+                reference.step(toroidal);
+                engine->step(current, next, toroidal);
+                std::swap(current, next);
+
+                const Grid &expected = reference.get_state();
+                int x0 = expected.get_width(), y0 = expected.get_height(), x1 = 0, y1 = 0;
+                for (int y = 0; y < expected.get_height(); ++y) {
+                    for (int x = 0; x < expected.get_width(); ++x) {
+                        if (expected(x, y) != current(x, y)) {
+                            x0 = std::min(x0, x);
+                            y0 = std::min(y0, y);
+                            x1 = std::max(x1, x + 1);
+                            y1 = std::max(y1, y + 1);
+                        }
+                    }
+                }
+                if (x1 == 0) {
+                    continue;
+                }
+
+                x0 = std::max(0, x0 - 1);
+                y0 = std::max(0, y0 - 1);
+                x1 = std::min(expected.get_width(), x1 + 1);
+                y1 = std::min(expected.get_height(), y1 + 1);
+
+                const std::string prefix = "validate-" + name;
+                Zoo::save_ascii(prefix + "-expected.gol", expected.view(x0, y0, x1, y1));
+                Zoo::save_ascii(prefix + "-actual.gol", current.view(x0, y0, x1, y1));
+
+                report << "Diverged on " << test.name << (toroidal ? " toroidal" : " bounded")
+                       << " at generation " << generation << " in region [" << x0 << ", " << x1 << ") by ["
+                       << y0 << ", " << y1 << ")" << std::endl
+                       << "Wrote " << prefix << "-expected.gol and " << prefix << "-actual.gol" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    report << "All " << cases.size() * 2 << " runs of " << generations << " generations matched." << std::endl;
+    return true;
+}
@@ -0,0 +1,42 @@
+/**
+ * Declares an interface for interchangeable Game of Life stepping engines and a registry of them by name.
+ * Rich documentation for the api and behaviour the Engine class can be found in engine.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the structure of the Engine interface for stepping a grid one generation.
+ */
+class Engine {
+
+public:
+    using Factory = std::function<std::unique_ptr<Engine>(int parameter)>;
+
+    virtual ~Engine() = default;
+
+    virtual std::string get_name() const = 0;
+
+    virtual void step(const Grid &current, Grid &next, bool toroidal) = 0;
+
+    static void add(const std::string &name, Factory factory);
+
+    static std::unique_ptr<Engine> create(const std::string &name);
+
+    static std::vector<std::string> get_names();
+
+    static std::vector<std::string> get_candidates();
+
+    static std::string tune(const Grid &state, bool toroidal);
+
+    static bool validate(const std::string &name, std::ostream &report, unsigned seed = 42, int generations = 200);
+};
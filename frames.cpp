@@ -0,0 +1,189 @@
+/**
+ * Implements a class for streaming generations as binary image frames, ready to pipe into a video encoder.
+ *      - By default frames are binary PBM (P4) images.
+ *          - One bit per pixel, rows padded to a whole byte, most significant bit first.
+ *          - Alive cells are black (1 bits), dead cells are white (0 bits).
+ *
+ *      - If a block size k is given frames are binary PGM (P5) images instead, for worlds too large to view
+ *        at one pixel per cell.
+ *          - Each pixel averages a k x k block of cells, from white when all are dead to black when all are alive.
+ *
+ *      - Every frame can be enlarged by an integer scale factor, repeating each pixel scale x scale times.
+ *      - Frames are concatenated on the stream, which is the layout ffmpeg reads with -f image2pipe.
+ *      - Each frame is built in a reusable buffer and written with a single call.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <stdexcept>
+#include "frames.h"
+
+/**
+ * FrameExporter::FrameExporter(path, scale = 1, block = 0)
+ *
+ * Construct an exporter writing frames to a file, or to standard output if the path is "-".
+ *
+ * @example
+ *
+ *      // Pipe 4x enlarged PBM frames into ffmpeg
+ *      //      ./Game_of_Life -f world.gol --frames - --frames-scale 4 | ffmpeg -f image2pipe -i - out.mp4
+ *      FrameExporter exporter("-", 4);
+ *      exporter.write(world.get_state());
+ *
+ * @param path
+ *      The std::string path to the file to write to, or "-" for standard output.
+ *
+ * @param scale
+ *      Optional parameter. The integer factor to enlarge every frame by. Defaults to 1.
+ *
+ * @param block
+ *      Optional parameter. If positive, write PGM frames averaging block x block cells per pixel. Defaults to 0.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the file cannot be opened or scale is not positive.
+ */
+
+FrameExporter::FrameExporter(const std::string &path, int scale, int block)
+        : file(nullptr), owns_file(path != "-"), scale(scale), block(block) {
+
+    if (scale <= 0 || block < 0) {
+        throw std::invalid_argument("Frame scale must be positive.");
+    }
+
+    file = owns_file ? std::fopen(path.c_str(), "wb") : stdout;
+
+    if (file == nullptr) {
+        throw std::invalid_argument("No such path.");
+    }
+}
+
+/**
+ * FrameExporter::~FrameExporter()
+ *
+ * Flush the stream and close the file if the exporter opened it.
+ */
+
+FrameExporter::~FrameExporter() {
+    if (owns_file) {
+        std::fclose(file);
+    } else {
+        std::fflush(file);
+    }
+}
+
+/**
+ * FrameExporter::write(grid)
+ *
+ * Append a frame of the grid to the stream.
+ *
+ * @param grid
+ *      The grid, or view of a grid, to write.
+ *
+ * @throws
+ *      Throws std::runtime_error if the frame cannot be written, for example because the encoder exited.
+ */
+
+void FrameExporter::write(ConstGridView grid) {
+    if (block > 0) {
+        write_pgm(grid);
+    } else {
+        write_pbm(grid);
+    }
+
+    if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size() || std::fflush(file) != 0) {
+        throw std::runtime_error("Failed to write frame.");
+    }
+}
+
+/**
+ * FrameExporter::write_pbm(grid)
+ *
+ * Private helper function to build a PBM frame in the buffer.
+ * Each row is packed eight cells at a time, then repeated for the scale.
+ */
+
+void FrameExporter::write_pbm(ConstGridView grid) {
+    int width = grid.get_width() * scale;
+    int height = grid.get_height() * scale;
+    std::size_t row_bytes = (std::size_t(width) + 7) / 8;
+
+    std::string header = "P4\n" + std::to_string(width) + " " + std::to_string(height) + "\n";
+    buffer.assign(header.begin(), header.end());
+    buffer.resize(header.size() + row_bytes * height, 0);
+
+    std::uint8_t *out = buffer.data() + header.size();
+
+    for (int y = 0; y < grid.get_height(); ++y) {
+        const Cell *cells = grid.row(y);
+        std::uint8_t *line = out + row_bytes * std::size_t(y) * scale;
+
+        if (scale == 1) {
+            int x = 0;
+            for (std::size_t byte = 0; x + 8 <= width; ++byte, x += 8) {
+                std::uint8_t bits = 0;
+                for (int bit = 0; bit < 8; ++bit) {
+                    bits = std::uint8_t((bits << 1) | (cells[x + bit] == Cell::ALIVE));
+                }
+                line[byte] = bits;
+            }
+            for (; x < width; ++x) {
+                line[x / 8] |= std::uint8_t((cells[x] == Cell::ALIVE) << (7 - x % 8));
+            }
+        } else {
+            for (int x = 0; x < width; ++x) {
+                line[x / 8] |= std::uint8_t((cells[x / scale] == Cell::ALIVE) << (7 - x % 8));
+            }
+        }
+
+        for (int repeat = 1; repeat < scale; ++repeat) {
+            std::copy(line, line + row_bytes, line + row_bytes * repeat);
+        }
+    }
+}
+
+/**
+ * FrameExporter::write_pgm(grid)
+ *
+ * Private helper function to build a PGM frame in the buffer, averaging block x block cells per pixel.
+ */
+
+void FrameExporter::write_pgm(ConstGridView grid) {
+    int pixels_x = (grid.get_width() + block - 1) / block;
+    int pixels_y = (grid.get_height() + block - 1) / block;
+    int width = pixels_x * scale;
+    int height = pixels_y * scale;
+
+    // Count the alive cells under every pixel a row of the grid at a time.
+    counts.assign(std::size_t(pixels_x) * pixels_y, 0);
+    for (int y = 0; y < grid.get_height(); ++y) {
+        const Cell *cells = grid.row(y);
+        int *line = &counts[std::size_t(y / block) * pixels_x];
+        for (int x = 0; x < grid.get_width(); ++x) {
+            line[x / block] += (cells[x] == Cell::ALIVE);
+        }
+    }
+
+    std::string header = "P5\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    buffer.assign(header.begin(), header.end());
+    buffer.resize(header.size() + std::size_t(width) * height);
+
+    std::uint8_t *out = buffer.data() + header.size();
+
+    for (int y = 0; y < pixels_y; ++y) {
+        int cells_y = std::min(block, grid.get_height() - y * block);
+        std::uint8_t *line = out + std::size_t(width) * y * scale;
+
+        for (int x = 0; x < pixels_x; ++x) {
+            int cells_x = std::min(block, grid.get_width() - x * block);
+            int alive = counts[std::size_t(y) * pixels_x + x];
+            std::uint8_t shade = std::uint8_t(255 - (255 * alive) / (cells_x * cells_y));
+
+            std::fill(line + std::size_t(x) * scale, line + std::size_t(x + 1) * scale, shade);
+        }
+
+        for (int repeat = 1; repeat < scale; ++repeat) {
+            std::copy(line, line + width, line + std::size_t(width) * repeat);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/**
+ * Declares a class for streaming generations as binary PBM or PGM image frames.
+ * Rich documentation for the api and behaviour the FrameExporter class can be found in frames.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the structure of the FrameExporter class for writing a stream of image frames.
+ */
+class FrameExporter {
+
+private:
+    std::FILE *file;
+    bool owns_file;
+    int scale;
+    int block;
+    std::vector<std::uint8_t> buffer;
+    std::vector<int> counts;
+
+    void write_pbm(ConstGridView grid);
+
+    void write_pgm(ConstGridView grid);
+
+public:
+    explicit FrameExporter(const std::string &path, int scale = 1, int block = 0);
+
+    ~FrameExporter();
+
+    FrameExporter(const FrameExporter &) = delete;
+
+    FrameExporter &operator=(const FrameExporter &) = delete;
+
+    void write(ConstGridView grid);
+};
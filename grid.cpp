@@ -2,7 +2,8 @@
  * Implements a class representing a 2d grid of cells.
  *      - New cells are initialized to Cell::DEAD.
  *      - Grids can be resized while retaining their contents in the remaining area.
- *      - Grids can be rotated, cropped, and merged together.
+ *      - Grids can be rotated, reflected, cropped, and merged together.
+ *      - Grids can visit just their alive cells, skipping dead runs in bulk.
  *      - Grids can return counts of the alive and dead cells.
  *      - Grids can be serialized directly to an ascii std::ostream.
  *
@@ -11,10 +12,17 @@
  * @author 958753
  * @date March, 2020
  */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include "grid.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 /**
  * Grid::Grid()
@@ -412,6 +420,69 @@ void Grid::set(int x, int y, int value) {
     operator()(x, y) = static_cast<Cell>(value);
 }
 
+/**
+ * Grid::row(y)
+ *
+ * Gets a modifiable pointer to the first cell of a row.
+ * The cells of a row are contiguous, so the pointer can be indexed from 0 to width - 1
+ * to write a whole row without checking every coordinate.
+ *
+ * @example
+ *
+ *      // Fill row 2 with alive cells
+ *      Cell *cells = grid.row(2);
+ *      std::fill(cells, cells + grid.get_width(), Cell::ALIVE);
+ *
+ * @param y
+ *      The y coordinate of the row.
+ *
+ * @return
+ *      A modifiable pointer to the cell at (0, y).
+ *
+ * @throws
+ *      std::exception or sub-class if y is not a valid row within the grid.
+ */
+
+Cell *Grid::row(int y) {
+
+    if (y < 0 || y >= grid_height) {
+        throw std::runtime_error("Row not valid.");
+    }
+    return cells_arr.data() + std::size_t(y) * grid_width;
+}
+
+/**
+ * Grid::row(y)
+ *
+ * Gets a read-only pointer to the first cell of a row.
+ * The cells of a row are contiguous, so the pointer can be indexed from 0 to width - 1
+ * to read a whole row without checking every coordinate.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Count the alive cells in row 2
+ *      const Cell *cells = grid.row(2);
+ *      int alive = std::count(cells, cells + grid.get_width(), Cell::ALIVE);
+ *
+ * @param y
+ *      The y coordinate of the row.
+ *
+ * @return
+ *      A read-only pointer to the cell at (0, y).
+ *
+ * @throws
+ *      std::exception or sub-class if y is not a valid row within the grid.
+ */
+
+const Cell *Grid::row(int y) const {
+
+    if (y < 0 || y >= grid_height) {
+        throw std::runtime_error("Row not valid.");
+    }
+    return cells_arr.data() + std::size_t(y) * grid_width;
+}
+
 /**
  * Grid::operator()(x, y)
  *
@@ -500,6 +571,7 @@ const Cell &Grid::operator()(int x, int y) const {
  *
  * Extract a sub-grid from a Grid.
  * The cropped grid spans the range [x0, x1) by [y0, y1) in the original grid.
+ * The window is validated once and then copied a row at a time.
  * The function should be callable from a constant context.
  *
  * @example
@@ -532,8 +604,8 @@ const Cell &Grid::operator()(int x, int y) const {
 
 Grid Grid::crop(int x0, int y0, int x1, int y1) const {
 
-    // Checks if the new coordinates are within the bounds of the old grid.
-    if (!are_valid_crop(x0, y0) || !are_valid_crop(x1, y1)) {
+    // Checks once that the crop window is within the bounds of the grid and has a positive size.
+    if (!are_valid_crop(x0, y0) || !are_valid_crop(x1, y1) || x1 < x0 || y1 < y0) {
         throw std::range_error("Grid is not in the required ranges.");
     }
 
@@ -543,20 +615,117 @@ Grid Grid::crop(int x0, int y0, int x1, int y1) const {
 
     Grid new_grid(new_grid_width, new_grid_height);
 
-    for (int i = 0, x = x0, y = y0, j = 0, z = 0; i < new_grid.get_total_cells(); ++i, ++x, ++j) {
-
-        // Simulates 2D matrix from the 1D array used to store the data.
-        if (x >= x1) {
-            x = x0;
-            j = 0;
-            y++;
-            z++;
-        }
-        new_grid(j, z) = get(x, y);
+    // Rows are contiguous, so each row of the window is a single block copy.
+    for (int y = 0; y < new_grid_height; ++y) {
+        auto source = cells_arr.begin() + get_index(x0, y0 + y);
+        std::copy(source, source + new_grid_width, new_grid.cells_arr.begin() + new_grid.get_index(0, y));
     }
     return new_grid;
 }
 
+/**
+ * Grid::view()
+ *
+ * Gets a modifiable view of the whole grid.
+ * The view does not copy any cells, writes through the view update the grid.
+ *
+ * @example
+ *
+ *      // Make a grid and clear it through a view
+ *      Grid grid(4, 4);
+ *      GridView all = grid.view();
+ *      all(1, 1) = Cell::ALIVE;
+ *
+ * @return
+ *      A view of every cell of the grid.
+ */
+
+GridView Grid::view() {
+    return GridView(cells_arr.data(), grid_width, grid_height, grid_width);
+}
+
+/**
+ * Grid::view()
+ *
+ * Gets a read-only view of the whole grid.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      A read-only view of every cell of the grid.
+ */
+
+ConstGridView Grid::view() const {
+    return ConstGridView(cells_arr.data(), grid_width, grid_height, grid_width);
+}
+
+/**
+ * Grid::view(x0, y0, x1, y1)
+ *
+ * Gets a modifiable view of the window [x0, x1) by [y0, y1) of the grid.
+ * Unlike Grid::crop no cells are copied, so a view is the cheap way to read or write a sub-region.
+ *
+ * @example
+ *
+ *      // Make a grid
+ *      Grid grid(4, 4);
+ *
+ *      // View the centre 2x2 of the grid and make it alive
+ *      GridView centre = grid.view(1, 1, 3, 3);
+ *      centre(0, 0) = Cell::ALIVE;
+ *
+ * @param x0
+ *      Left coordinate of the window on x-axis.
+ *
+ * @param y0
+ *      Top coordinate of the window on y-axis.
+ *
+ * @param x1
+ *      Right coordinate of the window on x-axis (1 greater than the largest index).
+ *
+ * @param y1
+ *      Bottom coordinate of the window on y-axis (1 greater than the largest index).
+ *
+ * @return
+ *      A view of the window.
+ *
+ * @throws
+ *      std::exception or sub-class if the window is not within the grid or has a negative size.
+ */
+
+GridView Grid::view(int x0, int y0, int x1, int y1) {
+
+    if (!are_valid_crop(x0, y0) || !are_valid_crop(x1, y1) || x1 < x0 || y1 < y0) {
+        throw std::range_error("Grid is not in the required ranges.");
+    }
+    return GridView(cells_arr.data() + std::size_t(y0) * grid_width + x0, x1 - x0, y1 - y0, grid_width);
+}
+
+/**
+ * Grid::view(x0, y0, x1, y1)
+ *
+ * Gets a read-only view of the window [x0, x1) by [y0, y1) of the grid.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Count the alive cells in the top left 8x8 of a grid without copying it
+ *      int alive = grid.view(0, 0, 8, 8).get_alive_cells();
+ *
+ * @return
+ *      A read-only view of the window.
+ *
+ * @throws
+ *      std::exception or sub-class if the window is not within the grid or has a negative size.
+ */
+
+ConstGridView Grid::view(int x0, int y0, int x1, int y1) const {
+
+    if (!are_valid_crop(x0, y0) || !are_valid_crop(x1, y1) || x1 < x0 || y1 < y0) {
+        throw std::range_error("Grid is not in the required ranges.");
+    }
+    return ConstGridView(cells_arr.data() + std::size_t(y0) * grid_width + x0, x1 - x0, y1 - y0, grid_width);
+}
+
 /**
  * Grid::merge(other, x0, y0, alive_only = false)
  *
@@ -567,6 +736,9 @@ Grid Grid::crop(int x0, int y0, int x1, int y1) const {
  *      - If a cell is originally dead it can be updated to be alive from the merge.
  *      - If a cell is originally alive it cannot be updated to be dead from the merge.
  *
+ * The other grid can be a Grid, a GridView, or a ConstGridView, so a window of another grid can be stamped
+ * without cropping it first. Its placement is validated once, then it is copied a row at a time.
+ *
  * @example
  *
  *      // Make two grids
@@ -579,7 +751,7 @@ Grid Grid::crop(int x0, int y0, int x1, int y1) const {
  *      y.merge(x, 2, 2, true);
  *
  * @param other
- *      The other grid to merge into the current grid.
+ *      The other grid, or view of a grid, to merge into the current grid.
  *
  * @param x0
  *      The x coordinate of where to place the top left corner of the other grid.
@@ -595,41 +767,183 @@ Grid Grid::crop(int x0, int y0, int x1, int y1) const {
  *      std::exception or sub-class if the other grid being placed does not fit within the bounds of the current grid.
  */
 
-void Grid::merge(Grid grid, int x0, int y0, bool alive_only) {
+void Grid::merge(ConstGridView grid, int x0, int y0, bool alive_only) {
 
-    if (!are_valid_crop(x0 + grid.get_width(), y0 + grid.get_height())) {
+    // Checks once that the other grid fits entirely within the bounds of the current grid.
+    if (!are_valid(x0, y0) || !are_valid_crop(x0 + grid.get_width(), y0 + grid.get_height())) {
         throw std::range_error("Grid is not in the required ranges.");
     }
 
-    for (int i = 0, x = x0, y = y0, j = 0, z = 0; i < grid.get_total_cells(); ++i, ++x, ++j) {
+    if (grid.get_total_cells() == 0) {
+        return;
+    }
 
-        // Simulates 2D matrix from the 1D array used to store the data.
-        if (j >= grid.get_width()) {
-            x = x0;
-            j = 0;
-            y++;
-            z++;
-        }
+    // Merging a view of this grid into itself reads from a copy so overlapping rows are not read after being written.
+    const Cell *first = grid.row(0);
+    if (first >= cells_arr.data() && first < cells_arr.data() + cells_arr.size()) {
+        Grid copy = grid.to_grid();
+        merge(copy, x0, y0, alive_only);
+        return;
+    }
+
+    for (int y = 0; y < grid.get_height(); ++y) {
+        const Cell *source = grid.row(y);
+        Cell *destination = cells_arr.data() + get_index(x0, y0 + y);
 
         if (alive_only) {
-            if (grid.get(j, z) == Cell::ALIVE) {
-                set(x, y, Cell::ALIVE);
+            // Branch free select so the compiler can vectorise the row.
+            for (int x = 0; x < grid.get_width(); ++x) {
+                destination[x] = (source[x] == Cell::ALIVE) ? Cell::ALIVE : destination[x];
             }
         } else {
-            set(x, y, grid.get(j, z));
+            std::copy(source, source + grid.get_width(), destination);
+        }
+    }
+}
+
+
+/**
+ * Grid::transformed(width, height, first, step_x, step_y)
+ *
+ * Private helper that builds a width x height grid whose cell (x, y) is read from
+ * cells_arr[first + x * step_x + y * step_y]. Every rotation and reflection is such an affine
+ * index mapping, so they all share this kernel.
+ *
+ * The destination is filled in square tiles so that when the source is walked down a column
+ * (step_x of plus or minus the grid width) the touched source rows stay in cache for the
+ * whole tile instead of being evicted after every destination row.
+ *
+ * @param width
+ *      The width of the resulting grid.
+ *
+ * @param height
+ *      The height of the resulting grid.
+ *
+ * @param first
+ *      The index in cells_arr of the source for the resulting cell (0, 0).
+ *
+ * @param step_x
+ *      The change in source index for a step of 1 along x in the result.
+ *
+ * @param step_y
+ *      The change in source index for a step of 1 along y in the result.
+ *
+ * @return
+ *      Returns the transformed copy of the grid.
+ */
+
+Grid Grid::transformed(int width, int height, long long first, long long step_x, long long step_y) const {
+    const int tile = 64;
+
+    Grid new_grid(width, height);
+    const Cell *source = cells_arr.data();
+    Cell *destination = new_grid.cells_arr.data();
+
+    for (int tile_y = 0; tile_y < height; tile_y += tile) {
+        const int end_y = std::min(tile_y + tile, height);
+        for (int tile_x = 0; tile_x < width; tile_x += tile) {
+            const int end_x = std::min(tile_x + tile, width);
+            for (int y = tile_y; y < end_y; ++y) {
+                long long index = first + tile_x * step_x + y * step_y;
+                Cell *line = destination + (long long) y * width;
+                for (int x = tile_x; x < end_x; ++x, index += step_x) {
+                    line[x] = source[index];
+                }
+            }
         }
     }
+    return new_grid;
 }
 
+/**
+ * Grid::transpose_in_place()
+ *
+ * Private helper that swaps every cell (x, y) with (y, x) of a square grid, one pair of
+ * tiles at a time so that both the row and the column side stay in cache.
+ */
+
+void Grid::transpose_in_place() {
+    const int tile = 64;
+    const int size = grid_width;
+    Cell *cells = cells_arr.data();
+
+    for (int tile_y = 0; tile_y < size; tile_y += tile) {
+        const int end_y = std::min(tile_y + tile, size);
+        for (int tile_x = tile_y; tile_x < size; tile_x += tile) {
+            const int end_x = std::min(tile_x + tile, size);
+            for (int y = tile_y; y < end_y; ++y) {
+                for (int x = std::max(tile_x, y + 1); x < end_x; ++x) {
+                    std::swap(cells[(long long) y * size + x], cells[(long long) x * size + y]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Grid::alive_masks(cells, count, masks)
+ *
+ * Private helper that compresses a run of cells into bit masks, bit i of masks[w] is set if cells[64 * w + i]
+ * is alive. Bits past count in the last mask are clear.
+ * Where SSE2 is available the cells are compared 16 at a time and gathered with a movemask, otherwise
+ * each 8 cell word is compared against a word of dead cells and only words with an alive cell are
+ * looked at cell by cell.
+ *
+ * @param cells
+ *      A pointer to the first cell.
+ *
+ * @param count
+ *      The number of cells.
+ *
+ * @param masks
+ *      Filled with (count + 63) / 64 masks.
+ */
+
+void Grid::alive_masks(const Cell *cells, int count, std::uint64_t *masks) {
+    int x = 0;
+    for (; x + 64 <= count; x += 64) {
+        std::uint64_t mask = 0;
+#if defined(__SSE2__)
+        const __m128i alive = _mm_set1_epi8(char(Cell::ALIVE));
+        for (int i = 0; i < 64; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cells + x + i));
+            mask |= std::uint64_t(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(block, alive)))) << i;
+        }
+#else
+        std::uint64_t dead;
+        std::memset(&dead, char(Cell::DEAD), sizeof(dead));
+        for (int i = 0; i < 64; i += 8) {
+            std::uint64_t block;
+            std::memcpy(&block, cells + x + i, sizeof(block));
+            if (block == dead) {
+                continue;
+            }
+            for (int j = i; j < i + 8; ++j) {
+                mask |= std::uint64_t(cells[x + j] == Cell::ALIVE) << j;
+            }
+        }
+#endif
+        *masks++ = mask;
+    }
+    if (x < count) {
+        std::uint64_t mask = 0;
+        for (int i = 0; x + i < count; ++i) {
+            mask |= std::uint64_t(cells[x + i] == Cell::ALIVE) << i;
+        }
+        *masks = mask;
+    }
+}
 
 /**
  * Grid::rotate(rotation)
  *
- * Create a copy of the grid that is rotated by a multiple of 90 degrees.
+ * Create a copy of the grid that is rotated by a multiple of 90 degrees clockwise.
  * The rotation can be any integer, positive, negative, or 0.
  * The function should take the same amount of time to execute for any valid integer input.
  * The function should be callable from a constant context.
  *
+ * The copy is produced tile by tile, see Grid::transformed.
+ *
  * @example
  *
  *      // Make a 1x3 grid
@@ -648,41 +962,137 @@ void Grid::merge(Grid grid, int x0, int y0, bool alive_only) {
 Grid Grid::rotate(int rotation) const {
 
     // The grid can only be in one of 4 states no matter the input. Transforms input into the correct state.
-    int rotation_state = rotation % 4;
+    int rotation_state = ((rotation % 4) + 4) % 4;
+
+    const long long width = grid_width;
+    const long long height = grid_height;
+
+    if (rotation_state == 1) {
+        return transformed(grid_height, grid_width, (height - 1) * width, -width, 1);
+    } else if (rotation_state == 2) {
+        return transformed(grid_width, grid_height, height * width - 1, -1, -width);
+    } else if (rotation_state == 3) {
+        return transformed(grid_height, grid_width, width - 1, width, -1);
+    }
+    return *this;
+}
 
-    Grid new_grid(grid_height, grid_width);
+/**
+ * Grid::rotate_in_place(rotation)
+ *
+ * Rotate the grid by a multiple of 90 degrees clockwise, the same as grid = grid.rotate(rotation).
+ * A half turn is always done without a second buffer. Quarter turns are done in place when the
+ * grid is square, otherwise the width and height swap and a rotated copy replaces the cells.
+ *
+ * @example
+ *
+ *      // Make a 4x4 grid and turn it a quarter clockwise
+ *      Grid grid(4);
+ *      grid.rotate_in_place(1);
+ *
+ * @param rotation
+ *      An positive or negative integer to rotate by in 90 intervals.
+ */
 
-    // Changes grid dimensions based on the input.
-    if (rotation_state == 2 || rotation_state == -2) {
-        new_grid.resize(grid_width, grid_height);
+void Grid::rotate_in_place(int rotation) {
+    int rotation_state = ((rotation % 4) + 4) % 4;
+
+    if (rotation_state == 2) {
+        std::reverse(cells_arr.begin(), cells_arr.end());
+    } else if (rotation_state != 0 && grid_width != grid_height) {
+        *this = rotate(rotation_state);
+    } else if (rotation_state == 1) {
+        transpose_in_place();
+        reflect_in_place(Reflection::HORIZONTAL);
+    } else if (rotation_state == 3) {
+        transpose_in_place();
+        reflect_in_place(Reflection::VERTICAL);
     }
+}
+
+/**
+ * Grid::reflect(axis)
+ *
+ * Create a mirrored copy of the grid.
+ *      Reflection::HORIZONTAL flips left to right, (x, y) moves to (width - x - 1, y).
+ *      Reflection::VERTICAL flips top to bottom, (x, y) moves to (x, height - y - 1).
+ *      Reflection::DIAGONAL transposes, (x, y) moves to (y, x).
+ *      Reflection::ANTI_DIAGONAL mirrors about the other diagonal,
+ *          (x, y) moves to (height - y - 1, width - x - 1).
+ * The diagonal reflections swap the width and height of the grid.
+ * Together with the four rotations these give all 8 symmetries of a pattern.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Make a 2x3 grid
+ *      Grid x(2,3);
+ *
+ *      // y is size 3x2
+ *      Grid y = x.reflect(Reflection::DIAGONAL);
+ *
+ * @param axis
+ *      The axis to mirror the grid about.
+ *
+ * @return
+ *      Returns a copy of the grid that has been reflected.
+ */
 
-    if (rotation_state == 0) {
-        return *this;
+Grid Grid::reflect(Reflection axis) const {
+    const long long width = grid_width;
+    const long long height = grid_height;
+
+    switch (axis) {
+        case Reflection::HORIZONTAL:
+            return transformed(grid_width, grid_height, width - 1, -1, width);
+        case Reflection::VERTICAL:
+            return transformed(grid_width, grid_height, (height - 1) * width, 1, -width);
+        case Reflection::DIAGONAL:
+            return transformed(grid_height, grid_width, 0, width, 1);
+        case Reflection::ANTI_DIAGONAL:
+            return transformed(grid_height, grid_width, height * width - 1, -width, -1);
     }
+    throw std::invalid_argument("Reflection not valid.");
+}
 
-    for (int i = 0, x = 0, y = 0; i < get_total_cells(); ++i, ++x) {
+/**
+ * Grid::reflect_in_place(axis)
+ *
+ * Mirror the grid about an axis, the same as grid = grid.reflect(axis).
+ * Horizontal and vertical flips are always done without a second buffer. The diagonal
+ * reflections are done in place when the grid is square, otherwise a reflected copy
+ * replaces the cells.
+ *
+ * @example
+ *
+ *      // Make a 3x3 grid and flip it top to bottom
+ *      Grid grid(3);
+ *      grid.reflect_in_place(Reflection::VERTICAL);
+ *
+ * @param axis
+ *      The axis to mirror the grid about.
+ */
 
-        // Simulates 2D matrix from the 1D array used to store the data.
-        if (x >= grid_width) {
-            x = 0;
-            y++;
+void Grid::reflect_in_place(Reflection axis) {
+    if (axis == Reflection::HORIZONTAL) {
+        for (int y = 0; y < grid_height; ++y) {
+            Cell *line = cells_arr.data() + (long long) y * grid_width;
+            std::reverse(line, line + grid_width);
         }
-
-        // Rearranges the grid based on the state.
-        if (rotation_state == 1 || rotation_state == -3) {
-            if (get(x, y) == Cell::ALIVE) {
-                new_grid(grid_height - y - 1, x) = Cell::ALIVE;
-            }
-        } else if (rotation_state == 2 || rotation_state == -2) {
-            new_grid(x, y) = cells_arr[(get_total_cells() - i) - 1];
-        } else if (rotation_state == 3 || rotation_state == -1) {
-            if (get(x, y) == Cell::ALIVE) {
-                new_grid(y, grid_width - x - 1) = Cell::ALIVE;
-            }
+    } else if (axis == Reflection::VERTICAL) {
+        for (int y = 0; y < grid_height / 2; ++y) {
+            Cell *top = cells_arr.data() + (long long) y * grid_width;
+            Cell *bottom = cells_arr.data() + (long long) (grid_height - y - 1) * grid_width;
+            std::swap_ranges(top, top + grid_width, bottom);
         }
+    } else if (grid_width != grid_height) {
+        *this = reflect(axis);
+    } else if (axis == Reflection::DIAGONAL) {
+        transpose_in_place();
+    } else {
+        transpose_in_place();
+        std::reverse(cells_arr.begin(), cells_arr.end());
     }
-    return new_grid;
 }
 
 /**
@@ -691,6 +1101,8 @@ Grid Grid::rotate(int rotation) const {
  * Serializes a grid to an ascii output stream.
  * The grid is printed wrapped in a border of - (dash), | (pipe), and + (plus) characters.
  * Alive cells are shown as # (hash) characters, dead cells with ' ' (space) characters.
+ * The frame is formatted with Grid::append_ascii and written to the stream in a single call,
+ * the stream is not flushed.
  *
  * The function should be callable on a constant Grid.
  *
@@ -723,32 +1135,30 @@ Grid Grid::rotate(int rotation) const {
  */
 
 std::ostream &operator<<(std::ostream &stream, const Grid &grid) {
+    return stream << ConstGridView(grid);
+}
 
-    stream << '+';
-    for (int i = 0; i < grid.get_width(); ++i) {
-        stream << '-';
-    }
-    stream << '+' << std::endl;
-
-    for (int y = 0; y < grid.get_height(); ++y) {
-        stream << '|';
-        for (int x = 0; x < grid.get_width(); ++x) {
-            if (grid.get(x, y) == Cell::ALIVE) {
-                stream << '#';
-            } else {
-                stream << ' ';
-            }
-        }
-        stream << '|' << std::endl;
-    }
-
-    stream << '+';
-    for (int i = 0; i < grid.get_width(); ++i) {
-        stream << '-';
-    }
-    stream << '+' << std::endl;
+/**
+ * Grid::append_ascii(buffer)
+ *
+ * Appends the bordered ascii form of the grid printed by operator<< to a string.
+ * The whole frame is sized up front and each row is converted in one tight loop,
+ * so a caller reusing the same buffer formats frames without any allocation.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Format a grid once and write it to the console in one go
+ *      std::string buffer;
+ *      grid.append_ascii(buffer);
+ *      std::cout.write(buffer.data(), buffer.size());
+ *
+ * @param buffer
+ *      The string to append the frame to.
+ */
 
-    return stream;
+void Grid::append_ascii(std::string &buffer) const {
+    ConstGridView(*this).append_ascii(buffer);
 }
 
 /**
@@ -845,4 +1255,394 @@ bool Grid::are_valid_other(int x, int y) const {
     } else {
         return are_valid(x, y);
     }
-}
\ No newline at end of file
+}
+
+/**
+ * GridView::GridView(cells, width, height, stride)
+ *
+ * Construct a modifiable view over cells owned elsewhere.
+ * Usually obtained from Grid::view rather than constructed directly.
+ *
+ * @param cells
+ *      Pointer to the top left cell of the view.
+ *
+ * @param width
+ *      The width of the view.
+ *
+ * @param height
+ *      The height of the view.
+ *
+ * @param stride
+ *      The number of cells between the start of one row and the start of the next.
+ */
+
+GridView::GridView(Cell *cells, int width, int height, int stride)
+        : cells(cells), view_width(width), view_height(height), view_stride(stride) {}
+
+/**
+ * GridView::get_width()
+ *
+ * @return
+ *      The width of the view.
+ */
+
+const int &GridView::get_width() const {
+    return view_width;
+}
+
+/**
+ * GridView::get_height()
+ *
+ * @return
+ *      The height of the view.
+ */
+
+const int &GridView::get_height() const {
+    return view_height;
+}
+
+/**
+ * GridView::get_stride()
+ *
+ * @return
+ *      The number of cells between the start of one row and the start of the next.
+ */
+
+const int &GridView::get_stride() const {
+    return view_stride;
+}
+
+/**
+ * GridView::get(x, y)
+ *
+ * Returns the value of the cell at the desired coordinate of the view.
+ *
+ * @throws
+ *      std::exception or sub-class if x,y is not a valid coordinate within the view.
+ */
+
+Cell GridView::get(int x, int y) const {
+    return operator()(x, y);
+}
+
+/**
+ * GridView::operator()(x, y)
+ *
+ * Gets a modifiable reference to the cell at the desired coordinate of the view.
+ * Views are shallow, so a constant view still refers to modifiable cells.
+ *
+ * @throws
+ *      std::exception or sub-class if x,y is not a valid coordinate within the view.
+ */
+
+Cell &GridView::operator()(int x, int y) const {
+
+    if (x < 0 || y < 0 || x >= view_width || y >= view_height) {
+        throw std::runtime_error("Coordinates not valid");
+    }
+    return cells[std::size_t(y) * view_stride + x];
+}
+
+/**
+ * GridView::set(x, y, value)
+ *
+ * Overwrites the value at the desired coordinate of the view.
+ *
+ * @throws
+ *      std::exception or sub-class if x,y is not a valid coordinate within the view.
+ */
+
+void GridView::set(int x, int y, int value) const {
+    operator()(x, y) = static_cast<Cell>(value);
+}
+
+/**
+ * GridView::row(y)
+ *
+ * Gets a modifiable pointer to the first cell of a row of the view, valid for width cells.
+ *
+ * @throws
+ *      std::exception or sub-class if y is not a valid row within the view.
+ */
+
+Cell *GridView::row(int y) const {
+
+    if (y < 0 || y >= view_height) {
+        throw std::runtime_error("Row not valid.");
+    }
+    return cells + std::size_t(y) * view_stride;
+}
+
+/**
+ * ConstGridView::ConstGridView(cells, width, height, stride)
+ *
+ * Construct a read-only view over cells owned elsewhere.
+ * Usually obtained from Grid::view, or by implicit conversion, rather than constructed directly.
+ *
+ * @param cells
+ *      Pointer to the top left cell of the view.
+ *
+ * @param width
+ *      The width of the view.
+ *
+ * @param height
+ *      The height of the view.
+ *
+ * @param stride
+ *      The number of cells between the start of one row and the start of the next.
+ */
+
+ConstGridView::ConstGridView(const Cell *cells, int width, int height, int stride)
+        : cells(cells), view_width(width), view_height(height), view_stride(stride) {}
+
+/**
+ * ConstGridView::ConstGridView(grid)
+ *
+ * Implicitly view a whole grid, so a Grid can be passed wherever a ConstGridView is expected.
+ *
+ * @example
+ *
+ *      // Save a whole grid and just a window of it with the same function
+ *      Zoo::save_ascii("all.gol", grid);
+ *      Zoo::save_ascii("corner.gol", grid.view(0, 0, 8, 8));
+ *
+ * @param grid
+ *      The grid to view.
+ */
+
+ConstGridView::ConstGridView(const Grid &grid) : ConstGridView(grid.view()) {}
+
+/**
+ * ConstGridView::ConstGridView(view)
+ *
+ * Implicitly view the same window as a modifiable view, read-only.
+ *
+ * @param view
+ *      The view to convert.
+ */
+
+ConstGridView::ConstGridView(const GridView &view)
+        : cells(view.get_height() > 0 ? view.row(0) : nullptr), view_width(view.get_width()),
+          view_height(view.get_height()), view_stride(view.get_stride()) {}
+
+/**
+ * ConstGridView::get_width()
+ *
+ * @return
+ *      The width of the view.
+ */
+
+const int &ConstGridView::get_width() const {
+    return view_width;
+}
+
+/**
+ * ConstGridView::get_height()
+ *
+ * @return
+ *      The height of the view.
+ */
+
+const int &ConstGridView::get_height() const {
+    return view_height;
+}
+
+/**
+ * ConstGridView::get_stride()
+ *
+ * @return
+ *      The number of cells between the start of one row and the start of the next.
+ */
+
+const int &ConstGridView::get_stride() const {
+    return view_stride;
+}
+
+/**
+ * ConstGridView::get_total_cells()
+ *
+ * @return
+ *      The number of cells in the view.
+ */
+
+int ConstGridView::get_total_cells() const {
+    return view_width * view_height;
+}
+
+/**
+ * ConstGridView::get_alive_cells()
+ *
+ * Counts how many cells in the view are alive, a row at a time.
+ *
+ * @example
+ *
+ *      // Population of the top left 8x8 of a grid, without copying it
+ *      int alive = grid.view(0, 0, 8, 8).get_alive_cells();
+ *
+ * @return
+ *      The number of alive cells.
+ */
+
+int ConstGridView::get_alive_cells() const {
+    int count = 0;
+
+    for (int y = 0; y < view_height; ++y) {
+        const Cell *line = row(y);
+        count += int(std::count(line, line + view_width, Cell::ALIVE));
+    }
+    return count;
+}
+
+/**
+ * ConstGridView::get_dead_cells()
+ *
+ * @return
+ *      The number of dead cells in the view.
+ */
+
+int ConstGridView::get_dead_cells() const {
+    return get_total_cells() - get_alive_cells();
+}
+
+/**
+ * ConstGridView::get(x, y)
+ *
+ * Returns the value of the cell at the desired coordinate of the view.
+ *
+ * @throws
+ *      std::exception or sub-class if x,y is not a valid coordinate within the view.
+ */
+
+Cell ConstGridView::get(int x, int y) const {
+    return operator()(x, y);
+}
+
+/**
+ * ConstGridView::operator()(x, y)
+ *
+ * Gets a read-only reference to the cell at the desired coordinate of the view.
+ *
+ * @throws
+ *      std::exception or sub-class if x,y is not a valid coordinate within the view.
+ */
+
+const Cell &ConstGridView::operator()(int x, int y) const {
+
+    if (x < 0 || y < 0 || x >= view_width || y >= view_height) {
+        throw std::runtime_error("Coordinates are invalid.");
+    }
+    return cells[std::size_t(y) * view_stride + x];
+}
+
+/**
+ * ConstGridView::row(y)
+ *
+ * Gets a read-only pointer to the first cell of a row of the view, valid for width cells.
+ *
+ * @throws
+ *      std::exception or sub-class if y is not a valid row within the view.
+ */
+
+const Cell *ConstGridView::row(int y) const {
+
+    if (y < 0 || y >= view_height) {
+        throw std::runtime_error("Row not valid.");
+    }
+    return cells + std::size_t(y) * view_stride;
+}
+
+/**
+ * ConstGridView::view(x0, y0, x1, y1)
+ *
+ * Gets a read-only view of the window [x0, x1) by [y0, y1) of this view.
+ *
+ * @return
+ *      A read-only view of the window.
+ *
+ * @throws
+ *      std::exception or sub-class if the window is not within the view or has a negative size.
+ */
+
+ConstGridView ConstGridView::view(int x0, int y0, int x1, int y1) const {
+
+    if (x0 < 0 || y0 < 0 || x1 > view_width || y1 > view_height || x1 < x0 || y1 < y0) {
+        throw std::range_error("Grid is not in the required ranges.");
+    }
+    return ConstGridView(cells + std::size_t(y0) * view_stride + x0, x1 - x0, y1 - y0, view_stride);
+}
+
+/**
+ * ConstGridView::to_grid()
+ *
+ * Copy the cells of the view into a new grid, the equivalent of Grid::crop for a view.
+ *
+ * @return
+ *      A new grid of the view size containing the cells of the view.
+ */
+
+Grid ConstGridView::to_grid() const {
+    Grid grid(view_width, view_height);
+    grid.merge(*this, 0, 0);
+    return grid;
+}
+
+/**
+ * ConstGridView::append_ascii(buffer)
+ *
+ * Appends the bordered ascii form of the view printed by operator<< to a string.
+ * The whole frame is sized up front and each row is converted in one tight loop,
+ * so a caller reusing the same buffer formats frames without any allocation.
+ *
+ * @param buffer
+ *      The string to append the frame to.
+ */
+
+void ConstGridView::append_ascii(std::string &buffer) const {
+    std::size_t line_length = std::size_t(view_width) + 3;
+    std::size_t start = buffer.size();
+
+    buffer.resize(start + line_length * (std::size_t(view_height) + 2));
+    char *out = &buffer[start];
+
+    // Top and bottom borders
+    char *bottom = out + line_length * (std::size_t(view_height) + 1);
+    for (char *line : {out, bottom}) {
+        line[0] = '+';
+        std::fill(line + 1, line + 1 + view_width, '-');
+        line[view_width + 1] = '+';
+        line[view_width + 2] = '\n';
+    }
+
+    for (int y = 0; y < view_height; ++y) {
+        char *line = out + line_length * (std::size_t(y) + 1);
+        const Cell *cells_row = row(y);
+
+        line[0] = '|';
+        for (int x = 0; x < view_width; ++x) {
+            line[x + 1] = (cells_row[x] == Cell::ALIVE) ? '#' : ' ';
+        }
+        line[view_width + 1] = '|';
+        line[view_width + 2] = '\n';
+    }
+}
+
+/**
+ * operator<<(output_stream, view)
+ *
+ * Serializes a view to an ascii output stream, in the same bordered form as a Grid.
+ *
+ * @example
+ *
+ *      // Print the top left 8x8 of a grid without copying it
+ *      std::cout << grid.view(0, 0, 8, 8) << std::endl;
+ *
+ * @return
+ *      Returns a reference to the output stream to enable operator chaining.
+ */
+
+std::ostream &operator<<(std::ostream &stream, ConstGridView view) {
+    std::string buffer;
+    view.append_ascii(buffer);
+
+    return stream.write(buffer.data(), std::streamsize(buffer.size()));
+}
@@ -12,7 +12,10 @@
 
 // Add the minimal number of includes you need in order to declare the class.
 // #include ...
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 /**
@@ -23,6 +26,21 @@ enum Cell : char {
     ALIVE = '#'
 };
 
+/**
+ * A Reflection names one of the four mirror axes of a grid, together with Grid::rotate
+ * these cover all 8 symmetries of a rectangle.
+ */
+enum Reflection : char {
+    HORIZONTAL,
+    VERTICAL,
+    DIAGONAL,
+    ANTI_DIAGONAL
+};
+
+class GridView;
+
+class ConstGridView;
+
 /**
  * Declare the structure of the Grid class for representing a 2d grid of cells.
  */
@@ -37,6 +55,11 @@ private:
 
     int get_index(int x, int y) const;
 
+    Grid transformed(int width, int height, long long first, long long step_x, long long step_y) const;
+
+    void transpose_in_place();
+
+    static void alive_masks(const Cell *cells, int count, std::uint64_t *masks);
 
 public:
 
@@ -68,12 +91,38 @@ public:
 
     void set(int X, int Y, int value);
 
+    Cell *row(int y);
+
+    const Cell *row(int y) const;
+
     Grid crop(int x0, int y0, int x1, int y1) const;
 
-    void merge(Grid grid, int x0, int y0, bool alive_only = false);
+    GridView view();
+
+    ConstGridView view() const;
+
+    GridView view(int x0, int y0, int x1, int y1);
+
+    ConstGridView view(int x0, int y0, int x1, int y1) const;
+
+    void merge(ConstGridView grid, int x0, int y0, bool alive_only = false);
 
     Grid rotate(int rotation) const;
 
+    void rotate_in_place(int rotation);
+
+    Grid reflect(Reflection axis) const;
+
+    void reflect_in_place(Reflection axis);
+
+    template <typename Function>
+    void for_each_alive(Function function) const;
+
+    template <typename Function>
+    void for_each_alive(int y0, int y1, Function function) const;
+
+    void append_ascii(std::string &buffer) const;
+
     friend std::ostream &operator<<(std::ostream &stream, const Grid &grid);
 
     bool are_valid(int x, int y) const;
@@ -82,4 +131,155 @@ public:
 
     bool are_valid_other(int x, int y) const;
 
-};
\ No newline at end of file
+};
+
+/**
+ * Declare the structure of the GridView class, a non-owning modifiable window onto the cells of a Grid.
+ *
+ * A view holds a pointer to its first cell, its width and height, and the stride between its rows.
+ * Views do not keep their grid alive and are invalidated when the grid is resized or destroyed.
+ */
+class GridView {
+
+private:
+
+    Cell *cells;
+    int view_width;
+    int view_height;
+    int view_stride;
+
+public:
+
+    explicit GridView(Cell *cells, int width, int height, int stride);
+
+    const int &get_width() const;
+
+    const int &get_height() const;
+
+    const int &get_stride() const;
+
+    Cell get(int x, int y) const;
+
+    Cell &operator()(int x, int y) const;
+
+    void set(int x, int y, int value) const;
+
+    Cell *row(int y) const;
+};
+
+/**
+ * Declare the structure of the ConstGridView class, a non-owning read-only window onto the cells of a Grid.
+ *
+ * Grids and GridViews convert to a ConstGridView implicitly, so functions that only read cells
+ * can accept any of them without a copy.
+ */
+class ConstGridView {
+
+private:
+
+    const Cell *cells;
+    int view_width;
+    int view_height;
+    int view_stride;
+
+public:
+
+    explicit ConstGridView(const Cell *cells, int width, int height, int stride);
+
+    ConstGridView(const Grid &grid);
+
+    ConstGridView(const GridView &view);
+
+    const int &get_width() const;
+
+    const int &get_height() const;
+
+    const int &get_stride() const;
+
+    int get_total_cells() const;
+
+    int get_alive_cells() const;
+
+    int get_dead_cells() const;
+
+    Cell get(int x, int y) const;
+
+    const Cell &operator()(int x, int y) const;
+
+    const Cell *row(int y) const;
+
+    ConstGridView view(int x0, int y0, int x1, int y1) const;
+
+    Grid to_grid() const;
+
+    void append_ascii(std::string &buffer) const;
+
+};
+
+std::ostream &operator<<(std::ostream &stream, ConstGridView view);
+
+/**
+ * Grid::for_each_alive(function)
+ *
+ * Call a function with the coordinates of every alive cell, in row-major order.
+ * Each row is first compressed into bit masks, see Grid::alive_masks, and only the set bits are
+ * visited, so sparse grids are walked far faster than by calling Grid::get for every cell.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Sum the x coordinates of the alive cells
+ *      long long sum = 0;
+ *      grid.for_each_alive([&](int x, int y) { sum += x; });
+ *
+ * @param function
+ *      A callable taking the x and y coordinates of an alive cell.
+ */
+
+template <typename Function>
+void Grid::for_each_alive(Function function) const {
+    for_each_alive(0, grid_height, function);
+}
+
+/**
+ * Grid::for_each_alive(y0, y1, function)
+ *
+ * Call a function with the coordinates of every alive cell in the rows [y0, y1), in row-major order.
+ * Disjoint row ranges can be visited from different threads to split a traversal.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Visit the top and bottom halves of a grid on two threads
+ *      std::thread top([&]() { grid.for_each_alive(0, grid.get_height() / 2, visit_top); });
+ *      grid.for_each_alive(grid.get_height() / 2, grid.get_height(), visit_bottom);
+ *      top.join();
+ *
+ * @param y0
+ *      The first row to visit.
+ *
+ * @param y1
+ *      One past the last row to visit.
+ *
+ * @param function
+ *      A callable taking the x and y coordinates of an alive cell.
+ *
+ * @throws
+ *      std::range_error if the rows are not in the range [0, height] or y1 is before y0.
+ */
+
+template <typename Function>
+void Grid::for_each_alive(int y0, int y1, Function function) const {
+    if (y0 < 0 || y1 > grid_height || y1 < y0) {
+        throw std::range_error("Grid is not in the required ranges.");
+    }
+    std::vector<std::uint64_t> masks((grid_width + 63) / 64);
+    for (int y = y0; y < y1; ++y) {
+        alive_masks(cells_arr.data() + (long long) y * grid_width, grid_width, masks.data());
+        for (int word = 0; word < int(masks.size()); ++word) {
+            for (std::uint64_t mask = masks[word]; mask != 0; mask &= mask - 1) {
+                function(word * 64 + __builtin_ctzll(mask), y);
+            }
+        }
+    }
+}
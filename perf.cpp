@@ -0,0 +1,214 @@
+/**
+ * Implements a class for reading hardware performance counters of the calling thread.
+ *      - On Linux each counter is opened with perf_event_open for the calling thread and any threads it starts
+ *        afterwards, in user space only.
+ *          - cycles, instructions, L1 data cache read misses, last level cache read misses, branch misses
+ *            and data TLB read misses.
+ *          - Counters are opened separately, so the ones the machine supports still work when others do not.
+ *          - Counters multiplexed by the kernel are scaled up by the fraction of time they were running.
+ *
+ *      - Counters that cannot be opened, for example in a restricted container or on other platforms, read as -1,
+ *        so callers can report them as missing instead of failing.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include "perf.h"
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char *const names[PerfCounters::COUNTERS] = {
+            "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"
+    };
+
+#if defined(__linux__)
+
+    /**
+     * cache_event(cache)
+     *
+     * The perf config for read misses of a hardware cache.
+     */
+
+    unsigned long long cache_event(unsigned long long cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    /**
+     * open_counter(type, config)
+     *
+     * Open a counter for the calling thread, returning -1 if it is not available.
+     */
+
+    int open_counter(unsigned type, unsigned long long config) {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = type;
+        attributes.config = config;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.inherit = 1;
+        attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return int(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+
+#endif
+}
+
+/**
+ * PerfCounters::PerfCounters()
+ *
+ * Open and start every counter the machine allows for the calling thread and the threads it starts.
+ * Counting carries on until the object is destroyed, work is measured by the difference of two reads.
+ * Threads already running are never counted, so start any thread whose work should be left out first.
+ * Reads include the threads started since, while they run and after they exit.
+ *
+ * @example
+ *
+ *      // Count the cycles of a step
+ *      PerfCounters counters;
+ *      PerfCounters::Sample start = counters.read();
+ *      world.step();
+ *      PerfCounters::Sample used = PerfCounters::difference(counters.read(), start);
+ *      std::cout << used.values[PerfCounters::CYCLES] << std::endl;
+ */
+
+PerfCounters::PerfCounters() : descriptors() {
+    for (int &descriptor : descriptors) {
+        descriptor = -1;
+    }
+
+#if defined(__linux__)
+    descriptors[CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    descriptors[INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    descriptors[L1D_MISSES] = open_counter(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D));
+    descriptors[LLC_MISSES] = open_counter(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL));
+    descriptors[BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    descriptors[DTLB_MISSES] = open_counter(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+}
+
+/**
+ * PerfCounters::~PerfCounters()
+ *
+ * Close every open counter.
+ */
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+    for (int descriptor : descriptors) {
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+    }
+#endif
+}
+
+/**
+ * PerfCounters::is_available()
+ *
+ * Checks if any counter could be opened.
+ *
+ * @return
+ *      Returns true if at least one counter is counting.
+ */
+
+bool PerfCounters::is_available() const {
+    for (int counter = 0; counter < COUNTERS; ++counter) {
+        if (is_available(Counter(counter))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * PerfCounters::is_available(counter)
+ *
+ * Checks if a counter could be opened.
+ *
+ * @param counter
+ *      The counter to check.
+ *
+ * @return
+ *      Returns true if the counter is counting.
+ */
+
+bool PerfCounters::is_available(Counter counter) const {
+    return descriptors[counter] >= 0;
+}
+
+/**
+ * PerfCounters::read()
+ *
+ * Read the running total of every counter.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The totals, -1 for counters that are not available or could not be read.
+ */
+
+PerfCounters::Sample PerfCounters::read() const {
+    Sample sample;
+    for (int counter = 0; counter < COUNTERS; ++counter) {
+        sample.values[counter] = -1;
+
+#if defined(__linux__)
+        // The value, then the time the counter was enabled and the time it was actually counting
+        unsigned long long values[3];
+        if (descriptors[counter] >= 0 && ::read(descriptors[counter], values, sizeof(values)) == sizeof(values)) {
+            sample.values[counter] = values[2] > 0 && values[2] < values[1]
+                                     ? (long long) ((double) values[0] * values[1] / values[2])
+                                     : (long long) values[0];
+        }
+#endif
+    }
+    return sample;
+}
+
+/**
+ * PerfCounters::difference(end, start)
+ *
+ * The counts between two reads.
+ *
+ * @param end
+ *      The later read.
+ *
+ * @param start
+ *      The earlier read.
+ *
+ * @return
+ *      The counts of end minus start, -1 for counters missing from either read.
+ */
+
+PerfCounters::Sample PerfCounters::difference(const Sample &end, const Sample &start) {
+    Sample sample;
+    for (int counter = 0; counter < COUNTERS; ++counter) {
+        sample.values[counter] = (end.values[counter] < 0 || start.values[counter] < 0)
+                                 ? -1 : end.values[counter] - start.values[counter];
+    }
+    return sample;
+}
+
+/**
+ * PerfCounters::get_name(counter)
+ *
+ * Gets the name of a counter, used as a column or key in reports.
+ *
+ * @param counter
+ *      The counter to name.
+ *
+ * @return
+ *      The name, such as "cycles" or "llc_misses".
+ */
+
+const char *PerfCounters::get_name(Counter counter) {
+    return names[counter];
+}
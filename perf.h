@@ -0,0 +1,57 @@
+/**
+ * Declares a class for reading hardware performance counters of the calling thread.
+ * Rich documentation for the api and behaviour the PerfCounters class can be found in perf.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+/**
+ * Declare the structure of the PerfCounters class for sampling hardware events around a piece of work.
+ */
+class PerfCounters {
+
+public:
+    /**
+     * The hardware events that are counted.
+     */
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        LLC_MISSES,
+        BRANCH_MISSES,
+        DTLB_MISSES,
+        COUNTERS
+    };
+
+    /**
+     * The value of every counter at one moment, -1 for a counter that is not available.
+     */
+    struct Sample {
+        long long values[COUNTERS];
+    };
+
+private:
+    int descriptors[COUNTERS];
+
+public:
+    explicit PerfCounters();
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool is_available() const;
+
+    bool is_available(Counter counter) const;
+
+    Sample read() const;
+
+    static Sample difference(const Sample &end, const Sample &start);
+
+    static const char *get_name(Counter counter);
+};
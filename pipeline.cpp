@@ -0,0 +1,328 @@
+/**
+ * Implements a class for handing generations from the simulation thread to consumers on their own threads,
+ * so printing and exporting never run inline with World::step.
+ *      - Generations are published into a bounded ring of pre-allocated grids, which are reused once every
+ *        consumer is done with them, so a steady run allocates nothing after the first lap of the ring.
+ *      - The ring is lock free. The simulation thread is the only producer, and each consumer runs on its own
+ *        thread with its own cursor into the ring.
+ *          - A slot is marked as being written, then overwritten once no consumer is copying out of it.
+ *          - Consumers copy a generation out of its slot and release it before handling it, so a slow
+ *            consumer only holds a slot for the length of a copy.
+ *
+ *      - Each consumer has a policy for falling behind:
+ *          - BLOCK     The simulation waits for the consumer, which sees every generation it asked for.
+ *          - DROP      The simulation never waits, generations overwritten before the consumer reaches them
+ *                      are skipped and the rest are handled in order.
+ *          - LATEST    The simulation never waits, the consumer skips straight to the newest generation it
+ *                      asked for whenever it is ready for another.
+ *
+ *      - Each consumer may filter the generations it asks for, generations no consumer wants are not published.
+ *      - Closing the pipeline lets every consumer finish what is left in the ring, then stops their threads.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include "pipeline.h"
+
+namespace {
+
+    /**
+     * back_off(idle)
+     *
+     * Wait for another thread to make progress, yielding at first and then sleeping so an idle consumer
+     * does not keep a core busy.
+     */
+
+    void back_off(int &idle) {
+        if (idle < 64) {
+            idle++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+/**
+ * Pipeline::Pipeline(capacity = 4)
+ *
+ * Construct a pipeline with a ring of capacity generations and no consumers.
+ *
+ * @example
+ *
+ *      // Print every generation from another thread
+ *      Pipeline pipeline;
+ *      pipeline.add_consumer(Pipeline::BLOCK, [](const Grid &grid, int generation) {
+ *          std::cout << generation << std::endl << grid << std::endl;
+ *      });
+ *      for (int generation = 1; generation <= 10; ++generation) {
+ *          world.step();
+ *          pipeline.publish(world.get_state(), generation);
+ *      }
+ *      pipeline.close();
+ *
+ * @param capacity
+ *      Optional parameter. The number of generations the ring holds. Defaults to 4.
+ *
+ * @throws
+ *      std::invalid_argument if the capacity is not positive.
+ */
+
+Pipeline::Pipeline(int capacity) : capacity(capacity), head(0), closed(false) {
+    if (capacity <= 0) {
+        throw std::invalid_argument("Capacity not valid.");
+    }
+    slots = std::make_unique<Slot[]>(std::size_t(capacity));
+}
+
+/**
+ * Pipeline::~Pipeline()
+ *
+ * Let every consumer finish and stop their threads. Errors from consumers are dropped, call Pipeline::close
+ * to see them.
+ */
+
+Pipeline::~Pipeline() {
+    closed.store(true, std::memory_order_release);
+    for (auto &reader : readers) {
+        if (reader->thread.joinable()) {
+            reader->thread.join();
+        }
+    }
+}
+
+/**
+ * Pipeline::add_consumer(policy, consumer, filter = nullptr)
+ *
+ * Start a thread handing published generations to a consumer, starting from the next one published.
+ * Consumers must be added from the thread that publishes.
+ *
+ * @example
+ *
+ *      // Show the newest of every 100th generation without ever slowing the simulation
+ *      pipeline.add_consumer(Pipeline::LATEST,
+ *                            [&](const Grid &grid, int generation) { viewer.show(grid, generation, false); },
+ *                            [](int generation) { return generation % 100 == 0; });
+ *
+ * @param policy
+ *      What happens when the consumer falls behind, Pipeline::BLOCK, Pipeline::DROP or Pipeline::LATEST.
+ *
+ * @param consumer
+ *      Called on the consumer thread with a copy of each generation it is handed and its generation number.
+ *      An exception stops the consumer and is reported by Pipeline::close.
+ *
+ * @param filter
+ *      Optional parameter. Called on the publishing thread to ask if the consumer wants a generation.
+ *      Defaults to nullptr, wanting every generation.
+ *
+ * @throws
+ *      std::invalid_argument if the pipeline is closed or already has 64 consumers.
+ */
+
+void Pipeline::add_consumer(Policy policy, Consumer consumer, Filter filter) {
+    if (closed.load(std::memory_order_acquire) || readers.size() >= 64) {
+        throw std::invalid_argument("Consumer not valid.");
+    }
+
+    readers.push_back(std::make_unique<Reader>());
+    Reader &reader = *readers.back();
+    reader.policy = policy;
+    reader.consumer = std::move(consumer);
+    reader.filter = std::move(filter);
+    reader.cursor.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    reader.thread = std::thread(&Pipeline::run, this, std::ref(reader), std::uint64_t(1) << (readers.size() - 1));
+}
+
+/**
+ * Pipeline::publish(grid, generation)
+ *
+ * Copy a generation into the ring for every consumer that wants it, doing nothing if none do.
+ * Waits only while a consumer with the Pipeline::BLOCK policy still needs the slot being reused.
+ *
+ * @param grid
+ *      The grid to publish.
+ *
+ * @param generation
+ *      The generation number of the grid, passed to the filters and consumers.
+ */
+
+void Pipeline::publish(const Grid &grid, int generation) {
+    std::uint64_t wanted = 0;
+    for (std::size_t i = 0; i < readers.size(); ++i) {
+        const Reader &reader = *readers[i];
+        if (!reader.finished.load(std::memory_order_acquire) && (!reader.filter || reader.filter(generation))) {
+            wanted |= std::uint64_t(1) << i;
+        }
+    }
+    if (wanted == 0) {
+        return;
+    }
+
+    const long long sequence = head.load(std::memory_order_relaxed);
+    Slot &slot = slots[sequence % capacity];
+
+    // Blocking consumers must have taken the generation the slot held a lap ago
+    for (auto &reader : readers) {
+        int idle = 0;
+        while (reader->policy == BLOCK && !reader->finished.load(std::memory_order_acquire)
+               && reader->cursor.load(std::memory_order_acquire) <= sequence - capacity) {
+            back_off(idle);
+        }
+    }
+
+    // Marking the slot before checking for readers means a consumer either sees the mark or is waited for
+    slot.sequence.store(-1);
+    int idle = 0;
+    while (slot.readers.load() > 0) {
+        back_off(idle);
+    }
+
+    slot.grid = grid;
+    slot.generation = generation;
+    slot.wanted = wanted;
+    slot.sequence.store(sequence, std::memory_order_release);
+    head.store(sequence + 1, std::memory_order_release);
+}
+
+/**
+ * Pipeline::close()
+ *
+ * Let every consumer finish the generations left in the ring, then stop their threads.
+ * Consumers with the Pipeline::LATEST policy only finish the newest generation they want.
+ *
+ * @throws
+ *      std::runtime_error with the message of the first consumer that failed.
+ */
+
+void Pipeline::close() {
+    closed.store(true, std::memory_order_release);
+
+    std::string error;
+    for (auto &reader : readers) {
+        if (reader->thread.joinable()) {
+            reader->thread.join();
+        }
+        if (error.empty()) {
+            error = reader->error;
+        }
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+/**
+ * Pipeline::take(sequence, bit, frame, generation, wanted)
+ *
+ * Private helper that copies a generation out of the ring if the consumer with the given bit wants it.
+ * Returns false if the slot no longer holds the generation, because it was overwritten or is being written.
+ */
+
+bool Pipeline::take(long long sequence, std::uint64_t bit, Grid &frame, int &generation, bool &wanted) {
+    Slot &slot = slots[sequence % capacity];
+
+    slot.readers.fetch_add(1);
+    if (slot.sequence.load() != sequence) {
+        slot.readers.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    generation = slot.generation;
+    wanted = (slot.wanted & bit) != 0;
+    if (wanted) {
+        frame = slot.grid;
+    }
+    slot.readers.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Pipeline::run(reader, bit)
+ *
+ * Private body of a consumer thread.
+ * Follows the ring according to the consumer's policy until the pipeline is closed and nothing is left.
+ */
+
+void Pipeline::run(Reader &reader, std::uint64_t bit) {
+    Grid frame;
+    long long next = reader.cursor.load(std::memory_order_relaxed);
+    int idle = 0;
+
+    while (true) {
+        const long long newest = head.load(std::memory_order_acquire);
+        if (next >= newest) {
+            // Check the head again after seeing the pipeline closed, the last publish may have come in between
+            if (closed.load(std::memory_order_acquire) && next >= head.load(std::memory_order_acquire)) {
+                break;
+            }
+            back_off(idle);
+            continue;
+        }
+        idle = 0;
+
+        int generation = 0;
+        bool wanted = false;
+
+        if (reader.policy == LATEST) {
+            // Walk back from the newest generation to the first one this consumer wants
+            const long long oldest = std::max(next, newest - capacity);
+            for (long long sequence = newest - 1; sequence >= oldest; --sequence) {
+                if (!take(sequence, bit, frame, generation, wanted) || wanted) {
+                    break;
+                }
+            }
+            next = newest;
+        } else {
+            const long long sequence = reader.policy == DROP ? std::max(next, newest - capacity) : next;
+            if (!take(sequence, bit, frame, generation, wanted)) {
+                // Overwritten while catching up, look again at where the ring has got to
+                next = sequence;
+                continue;
+            }
+            next = sequence + 1;
+        }
+        reader.cursor.store(next, std::memory_order_release);
+
+        if (wanted) {
+            try {
+                reader.consumer(frame, generation);
+            }
+            catch (const std::exception &ex) {
+                reader.error = ex.what();
+                break;
+            }
+        }
+    }
+    reader.finished.store(true, std::memory_order_release);
+}
+
+/**
+ * Pipeline::parse_policy(name)
+ *
+ * Parse the name of a policy for falling behind.
+ *
+ * @param name
+ *      One of "block", "drop" or "latest".
+ *
+ * @return
+ *      The named Pipeline::Policy.
+ *
+ * @throws
+ *      std::invalid_argument if the name is not a policy.
+ */
+
+Pipeline::Policy Pipeline::parse_policy(const std::string &name) {
+    if (name == "block") {
+        return BLOCK;
+    }
+    if (name == "drop") {
+        return DROP;
+    }
+    if (name == "latest") {
+        return LATEST;
+    }
+    throw std::invalid_argument("Policy not valid.");
+}
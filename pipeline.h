@@ -0,0 +1,89 @@
+/**
+ * Declares a class for handing generations from the simulation thread to consumers running on their own threads.
+ * Rich documentation for the api and behaviour the Pipeline class can be found in pipeline.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the structure of the Pipeline class, a bounded single producer, multiple consumer ring of generations.
+ */
+class Pipeline {
+
+public:
+    /**
+     * What a consumer that falls behind costs, see Pipeline::add_consumer.
+     */
+    enum Policy : char {
+        BLOCK,
+        DROP,
+        LATEST
+    };
+
+    using Consumer = std::function<void(const Grid &grid, int generation)>;
+
+    using Filter = std::function<bool(int generation)>;
+
+private:
+    /**
+     * A pre-allocated buffer holding one published generation.
+     */
+    struct Slot {
+        Grid grid;
+        int generation = 0;
+        std::uint64_t wanted = 0;
+        std::atomic<long long> sequence{-1};
+        std::atomic<int> readers{0};
+    };
+
+    /**
+     * A consumer and the thread running it.
+     */
+    struct Reader {
+        Policy policy;
+        Consumer consumer;
+        Filter filter;
+        std::atomic<long long> cursor{0};
+        std::atomic<bool> finished{false};
+        std::string error;
+        std::thread thread;
+    };
+
+    int capacity;
+    std::unique_ptr<Slot[]> slots;
+    std::vector<std::unique_ptr<Reader>> readers;
+    std::atomic<long long> head;
+    std::atomic<bool> closed;
+
+    bool take(long long sequence, std::uint64_t bit, Grid &frame, int &generation, bool &wanted);
+
+    void run(Reader &reader, std::uint64_t bit);
+
+public:
+    explicit Pipeline(int capacity = 4);
+
+    ~Pipeline();
+
+    Pipeline(const Pipeline &) = delete;
+
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    void add_consumer(Policy policy, Consumer consumer, Filter filter = nullptr);
+
+    void publish(const Grid &grid, int generation);
+
+    void close();
+
+    static Policy parse_policy(const std::string &name);
+};
@@ -0,0 +1,424 @@
+/**
+ * Implements classes for recording the trajectory of a World and reconstructing any generation of it.
+ *      - A Recorder appends one record per generation to a recording file.
+ *          - Every keyframe_interval generations, and whenever the grid changes size, a keyframe holding the
+ *            whole grid is written.
+ *          - Every other generation is written as a delta listing the cells that changed since the previous one,
+ *            so the size of a recording grows with the activity of the pattern, not the area of the grid.
+ *          - When closed, an index of the keyframes is appended to the file.
+ *
+ *      - A Recording reads a recording file back and reconstructs any generation by seeking to the nearest
+ *        keyframe at or before it and applying the deltas that follow.
+ *          - If the file has no index, for example because the recorder crashed, the records are scanned
+ *            to rebuild it and any truncated final record is ignored.
+ *
+ *      - Recording files (.rgol) are composed of:
+ *          - the 4 byte magic "GOLR" and a 4 byte int keyframe interval.
+ *          - followed by one record per generation, each a 1 byte type ('K' or 'D'), a 4 byte int generation,
+ *            a 4 byte payload length, and the payload.
+ *              - Keyframe payloads are the grid width and height as variable length integers, followed by
+ *                the run length encoded bitstream of the grid (see codec.cpp).
+ *              - Delta payloads are the number of changed cells, followed by the gaps between the 1d indices
+ *                of consecutive changed cells, all as variable length integers.
+ *          - followed by the index: a 4 byte count, then a 4 byte generation and 8 byte offset for every keyframe.
+ *          - followed by the 8 byte offset of the index, the 4 byte number of generations and the 4 byte magic "GOLI".
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <stdexcept>
+#include "codec.h"
+#include "recording.h"
+
+/**
+ * Recorder::Recorder(path, keyframe_interval = 1000)
+ *
+ * Construct a recorder that writes a new recording file.
+ *
+ * @example
+ *
+ *      // Record a world, writing a keyframe every 500 generations
+ *      Recorder recorder("path/to/run.rgol", 500);
+ *      recorder.record(world.get_state());
+ *      for (int i = 0; i < 1000; ++i) {
+ *          world.step();
+ *          recorder.record(world.get_state());
+ *      }
+ *      recorder.close();
+ *
+ * @param path
+ *      The std::string path to the file to write to.
+ *
+ * @param keyframe_interval
+ *      Optional parameter. The number of generations between keyframes. Defaults to 1000.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the file cannot be opened or the interval is not positive.
+ */
+
+Recorder::Recorder(std::string path, int keyframe_interval)
+        : out_file(path, std::ios::binary), keyframe_interval(keyframe_interval), generation(0), offset(8) {
+
+    if (!out_file.is_open()) {
+        throw std::invalid_argument("No such path.");
+    }
+
+    if (keyframe_interval <= 0) {
+        throw std::invalid_argument("Keyframe interval must be positive.");
+    }
+
+    out_file.write("GOLR", 4);
+    out_file.write(reinterpret_cast<const char *>(&keyframe_interval), 4);
+}
+
+/**
+ * Recorder::~Recorder()
+ *
+ * Close the recording if Recorder::close() has not been called, swallowing any error.
+ */
+
+Recorder::~Recorder() {
+    try {
+        close();
+    }
+    catch (const std::exception &) {
+    }
+}
+
+/**
+ * Recorder::record(state)
+ *
+ * Append the next generation to the recording.
+ * The first call records generation 0.
+ *
+ * @param state
+ *      The grid state of the generation.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the recording has been closed or cannot be written.
+ */
+
+void Recorder::record(const Grid &state) {
+
+    if (!out_file.is_open()) {
+        throw std::runtime_error("Recording is closed.");
+    }
+
+    std::vector<std::uint8_t> payload;
+
+    bool resized = state.get_width() != previous.get_width() || state.get_height() != previous.get_height();
+
+    if (generation % keyframe_interval == 0 || resized) {
+        Codec::put_varint(payload, std::uint64_t(state.get_width()));
+        Codec::put_varint(payload, std::uint64_t(state.get_height()));
+
+        std::vector<std::uint8_t> bits = Codec::rle_encode(
+                Codec::pack_bits(state, 0, 0, state.get_width(), state.get_height()));
+        payload.insert(payload.end(), bits.begin(), bits.end());
+
+        keyframes.emplace_back(generation, offset);
+        write_record('K', payload);
+        out_file.flush();
+        previous = state;
+    } else {
+        std::vector<std::uint8_t> gaps;
+        std::uint64_t changed = 0;
+        std::uint64_t last = 0;
+
+        // Skip to each changed cell a row at a time, and bring only the rows that changed up to date
+        const int width = state.get_width();
+        for (int y = 0; y < state.get_height(); ++y) {
+            const Cell *now = state.row(y);
+            Cell *before = previous.row(y);
+            const Cell *cell = now;
+            bool row_changed = false;
+
+            while ((cell = std::mismatch(cell, now + width, before + (cell - now)).first) != now + width) {
+                std::uint64_t index = std::uint64_t(y) * width + std::uint64_t(cell - now);
+                Codec::put_varint(gaps, changed == 0 ? index : index - last - 1);
+                last = index;
+                changed++;
+                row_changed = true;
+                ++cell;
+            }
+            if (row_changed) {
+                std::copy(now, now + width, before);
+            }
+        }
+
+        Codec::put_varint(payload, changed);
+        payload.insert(payload.end(), gaps.begin(), gaps.end());
+        write_record('D', payload);
+    }
+
+    generation++;
+
+    if (!out_file) {
+        throw std::runtime_error("Failed to write recording.");
+    }
+}
+
+/**
+ * Recorder::close()
+ *
+ * Append the keyframe index and close the recording file.
+ * Calling close more than once has no further effect.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the index cannot be written.
+ */
+
+void Recorder::close() {
+
+    if (!out_file.is_open()) {
+        return;
+    }
+
+    std::uint64_t index_offset = offset;
+    int count = int(keyframes.size());
+
+    out_file.write(reinterpret_cast<const char *>(&count), 4);
+    for (const auto &keyframe : keyframes) {
+        out_file.write(reinterpret_cast<const char *>(&keyframe.first), 4);
+        out_file.write(reinterpret_cast<const char *>(&keyframe.second), 8);
+    }
+    out_file.write(reinterpret_cast<const char *>(&index_offset), 8);
+    out_file.write(reinterpret_cast<const char *>(&generation), 4);
+    out_file.write("GOLI", 4);
+
+    bool failed = !out_file;
+    out_file.close();
+
+    if (failed) {
+        throw std::runtime_error("Failed to write recording.");
+    }
+}
+
+/**
+ * Recorder::get_generations()
+ *
+ * Gets the number of generations recorded so far.
+ *
+ * @return
+ *      The number of generations recorded.
+ */
+
+int Recorder::get_generations() const {
+    return generation;
+}
+
+/**
+ * Recorder::write_record(type, payload)
+ *
+ * Private helper function to append a single record to the file.
+ */
+
+void Recorder::write_record(char type, const std::vector<std::uint8_t> &payload) {
+    std::uint32_t length = std::uint32_t(payload.size());
+
+    out_file.write(&type, 1);
+    out_file.write(reinterpret_cast<const char *>(&generation), 4);
+    out_file.write(reinterpret_cast<const char *>(&length), 4);
+    out_file.write(reinterpret_cast<const char *>(payload.data()), std::streamsize(payload.size()));
+
+    offset += 9 + payload.size();
+}
+
+/**
+ * Recording::Recording(path)
+ *
+ * Open a recording file for reading, loading its keyframe index or rebuilding it if the file was not closed.
+ *
+ * @example
+ *
+ *      // Reconstruct generation 731002 of a run
+ *      Recording recording("path/to/run.rgol");
+ *      Grid grid = recording.seek(731002);
+ *
+ * @param path
+ *      The std::string path to the file to read in.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the file cannot be opened or is not a recording.
+ */
+
+Recording::Recording(std::string path) : in_file(path, std::ios::binary), file_size(0), generations(0) {
+
+    if (!in_file.is_open()) {
+        throw std::invalid_argument("File not found.");
+    }
+
+    char magic[4];
+    in_file.read(magic, 4);
+    if (!in_file || std::string(magic, 4) != "GOLR") {
+        throw std::invalid_argument("Malformed file.");
+    }
+
+    in_file.seekg(0, std::ios::end);
+    file_size = std::uint64_t(in_file.tellg());
+
+    // Prefer the index written by Recorder::close().
+    if (file_size >= 28) {
+        std::uint64_t index_offset;
+        int count = 0;
+
+        in_file.seekg(std::streamoff(file_size - 16));
+        in_file.read(reinterpret_cast<char *>(&index_offset), 8);
+        in_file.read(reinterpret_cast<char *>(&generations), 4);
+        in_file.read(magic, 4);
+
+        if (in_file && std::string(magic, 4) == "GOLI" && index_offset < file_size) {
+            in_file.seekg(std::streamoff(index_offset));
+            in_file.read(reinterpret_cast<char *>(&count), 4);
+
+            if (in_file && count >= 0 && index_offset + 4 + std::uint64_t(count) * 12 + 16 == file_size) {
+                for (int i = 0; i < count; ++i) {
+                    std::pair<int, std::uint64_t> keyframe;
+                    in_file.read(reinterpret_cast<char *>(&keyframe.first), 4);
+                    in_file.read(reinterpret_cast<char *>(&keyframe.second), 8);
+                    keyframes.push_back(keyframe);
+                }
+                return;
+            }
+        }
+    }
+
+    // Otherwise scan the records, stopping at the first truncated or malformed one.
+    in_file.clear();
+    in_file.seekg(8);
+    generations = 0;
+    keyframes.clear();
+
+    char type;
+    int generation;
+    std::vector<std::uint8_t> payload;
+    std::uint64_t offset = 8;
+
+    while (read_record(type, generation, payload) && generation == generations) {
+        if (type == 'K') {
+            keyframes.emplace_back(generation, offset);
+        } else if (type != 'D' || keyframes.empty()) {
+            break;
+        }
+        offset += 9 + payload.size();
+        generations++;
+    }
+    in_file.clear();
+}
+
+/**
+ * Recording::get_generations()
+ *
+ * Gets the number of generations in the recording.
+ *
+ * @return
+ *      The number of generations, valid generations range from 0 to one less than this.
+ */
+
+int Recording::get_generations() const {
+    return generations;
+}
+
+/**
+ * Recording::seek(generation)
+ *
+ * Reconstruct the grid state of a generation.
+ * Reads the nearest keyframe at or before the generation and applies the deltas up to it,
+ * so the cost is bounded by the keyframe interval no matter how long the recording is.
+ *
+ * @param generation
+ *      The generation to reconstruct.
+ *
+ * @return
+ *      The grid state of the generation.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the generation is not in the recording or a record is malformed.
+ */
+
+Grid Recording::seek(int generation) {
+
+    if (generation < 0 || generation >= generations) {
+        throw std::range_error("Generation is not in the recording.");
+    }
+
+    auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), std::make_pair(generation, UINT64_MAX));
+    if (keyframe == keyframes.begin()) {
+        throw std::invalid_argument("Malformed file.");
+    }
+    --keyframe;
+
+    in_file.clear();
+    in_file.seekg(std::streamoff(keyframe->second));
+
+    Grid grid;
+    char type;
+    int record_generation;
+    std::vector<std::uint8_t> payload;
+
+    for (int current = keyframe->first; current <= generation; ++current) {
+
+        if (!read_record(type, record_generation, payload) || record_generation != current) {
+            throw std::invalid_argument("Malformed file.");
+        }
+
+        std::size_t position = 0;
+
+        if (type == 'K') {
+            int width = int(Codec::get_varint(payload, position));
+            int height = int(Codec::get_varint(payload, position));
+
+            std::vector<std::uint8_t> compressed(payload.begin() + std::ptrdiff_t(position), payload.end());
+            grid = Grid(width, height);
+            Codec::unpack_bits(Codec::rle_decode(compressed, (std::size_t(width) * height + 7) / 8),
+                               width, height, grid, 0, 0);
+
+        } else if (type == 'D') {
+            std::uint64_t changed = Codec::get_varint(payload, position);
+            std::uint64_t index = 0;
+
+            for (std::uint64_t i = 0; i < changed; ++i) {
+                std::uint64_t gap = Codec::get_varint(payload, position);
+                index = (i == 0) ? gap : index + gap + 1;
+
+                if (index >= std::uint64_t(grid.get_total_cells())) {
+                    throw std::invalid_argument("Malformed file.");
+                }
+
+                Cell &cell = grid(int(index % grid.get_width()), int(index / grid.get_width()));
+                cell = (cell == Cell::ALIVE) ? Cell::DEAD : Cell::ALIVE;
+            }
+
+        } else {
+            throw std::invalid_argument("Malformed file.");
+        }
+    }
+    return grid;
+}
+
+/**
+ * Recording::read_record(type, generation, payload)
+ *
+ * Private helper function to read the record at the current file position.
+ *
+ * @return
+ *      True if a whole record was read, false if the file ended part way through it.
+ */
+
+bool Recording::read_record(char &type, int &generation, std::vector<std::uint8_t> &payload) {
+    std::uint32_t length;
+
+    in_file.read(&type, 1);
+    in_file.read(reinterpret_cast<char *>(&generation), 4);
+    in_file.read(reinterpret_cast<char *>(&length), 4);
+
+    if (!in_file || std::uint64_t(in_file.tellg()) + length > file_size) {
+        return false;
+    }
+
+    payload.resize(length);
+    in_file.read(reinterpret_cast<char *>(payload.data()), std::streamsize(length));
+
+    return bool(in_file);
+}
@@ -0,0 +1,63 @@
+/**
+ * Declares classes for recording the trajectory of a World to file and seeking back to any generation.
+ * Rich documentation for the api and behaviour the Recorder and Recording classes can be found in recording.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the structure of the Recorder class for appending generations to a recording file.
+ */
+class Recorder {
+
+private:
+    std::ofstream out_file;
+    int keyframe_interval;
+    int generation;
+    std::uint64_t offset;
+    Grid previous;
+    std::vector<std::pair<int, std::uint64_t>> keyframes;
+
+    void write_record(char type, const std::vector<std::uint8_t> &payload);
+
+public:
+    explicit Recorder(std::string path, int keyframe_interval = 1000);
+
+    ~Recorder();
+
+    void record(const Grid &state);
+
+    void close();
+
+    int get_generations() const;
+};
+
+/**
+ * Declare the structure of the Recording class for reading back any generation of a recording file.
+ */
+class Recording {
+
+private:
+    std::ifstream in_file;
+    std::uint64_t file_size;
+    int generations;
+    std::vector<std::pair<int, std::uint64_t>> keyframes;
+
+    bool read_record(char &type, int &generation, std::vector<std::uint8_t> &payload);
+
+public:
+    explicit Recording(std::string path);
+
+    int get_generations() const;
+
+    Grid seek(int generation);
+};
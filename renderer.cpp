@@ -0,0 +1,162 @@
+/**
+ * Implements a class for printing grids to an output stream as whole frames.
+ *      - Each frame is formatted into a reusable buffer with Grid::append_ascii and handed to the
+ *        stream in a single write, instead of one character and one flush at a time.
+ *      - Frames are printed as the caption, the bordered grid, and a blank line, matching the
+ *        console output of Game_of_Life.
+ *
+ *      - A threaded renderer copies each grid into a queue of recycled snapshots and prints them
+ *        on its own render thread, so printing does not throttle the simulation.
+ *          - Frames are always printed in order and none are dropped.
+ *          - The caller only waits when the queue already holds depth frames.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include "renderer.h"
+
+/**
+ * Renderer::Renderer(stream = std::cout, threaded = false, depth = 4)
+ *
+ * Construct a renderer printing to the given stream.
+ *
+ * @example
+ *
+ *      // Print frames to the console from a render thread
+ *      Renderer renderer(std::cout, true);
+ *      renderer.render(world.get_state(), "Step 1 of 10\n");
+ *
+ * @param stream
+ *      Optional parameter. The stream to print to. Defaults to std::cout.
+ *
+ * @param threaded
+ *      Optional parameter. If true frames are printed on a separate render thread. Defaults to false.
+ *
+ * @param depth
+ *      Optional parameter. The number of frames a threaded renderer may queue before render blocks. Defaults to 4.
+ */
+
+Renderer::Renderer(std::ostream &stream, bool threaded, int depth)
+        : stream(stream), threaded(threaded), depth(std::size_t(std::max(1, depth))), busy(false), stopping(false) {
+    if (threaded) {
+        thread = std::thread(&Renderer::run, this);
+    }
+}
+
+/**
+ * Renderer::~Renderer()
+ *
+ * Print any queued frames and stop the render thread.
+ */
+
+Renderer::~Renderer() {
+    if (threaded) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+}
+
+/**
+ * Renderer::render(grid, caption = "")
+ *
+ * Print a frame of the grid preceded by a caption.
+ * A threaded renderer copies the grid into a recycled snapshot and returns without waiting for it to print.
+ *
+ * @param grid
+ *      The grid to print.
+ *
+ * @param caption
+ *      Optional parameter. Text printed before the grid, including its own newlines. Defaults to none.
+ */
+
+void Renderer::render(const Grid &grid, const std::string &caption) {
+
+    if (!threaded) {
+        write(grid, caption);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return pending.size() < depth; });
+
+    // Reuse a printed snapshot so steady state rendering does not allocate.
+    Frame frame;
+    if (!spare.empty()) {
+        frame = std::move(spare.back());
+        spare.pop_back();
+    }
+    lock.unlock();
+
+    frame.grid = grid;
+    frame.caption = caption;
+
+    lock.lock();
+    pending.push_back(std::move(frame));
+    lock.unlock();
+    changed.notify_all();
+}
+
+/**
+ * Renderer::flush()
+ *
+ * Block until every queued frame has been printed, then flush the stream.
+ * Call this before printing to the same stream from elsewhere.
+ */
+
+void Renderer::flush() {
+    if (threaded) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return pending.empty() && !busy; });
+    }
+    stream.flush();
+}
+
+/**
+ * Renderer::write(grid, caption)
+ *
+ * Private helper function to format a frame into the buffer and write it to the stream.
+ */
+
+void Renderer::write(const Grid &grid, const std::string &caption) {
+    buffer.assign(caption);
+    grid.append_ascii(buffer);
+    buffer += '\n';
+
+    stream.write(buffer.data(), std::streamsize(buffer.size()));
+    stream.flush();
+}
+
+/**
+ * Renderer::run()
+ *
+ * Private body of the render thread, printing queued frames in order until the renderer is destroyed.
+ */
+
+void Renderer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        changed.wait(lock, [this]() { return !pending.empty() || stopping; });
+
+        if (pending.empty()) {
+            return;
+        }
+
+        Frame frame = std::move(pending.front());
+        pending.pop_front();
+        busy = true;
+        lock.unlock();
+
+        write(frame.grid, frame.caption);
+
+        lock.lock();
+        spare.push_back(std::move(frame));
+        busy = false;
+        changed.notify_all();
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * Declares a class for printing grids to an output stream as whole frames, optionally from a render thread.
+ * Rich documentation for the api and behaviour the Renderer class can be found in renderer.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the structure of the Renderer class for printing frames of a simulation.
+ */
+class Renderer {
+
+private:
+    /**
+     * A snapshot waiting to be printed by the render thread.
+     */
+    struct Frame {
+        Grid grid;
+        std::string caption;
+    };
+
+    std::ostream &stream;
+    std::string buffer;
+
+    bool threaded;
+    std::size_t depth;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Frame> pending;
+    std::vector<Frame> spare;
+    bool busy;
+    bool stopping;
+
+    void write(const Grid &grid, const std::string &caption);
+
+    void run();
+
+public:
+    explicit Renderer(std::ostream &stream = std::cout, bool threaded = false, int depth = 4);
+
+    ~Renderer();
+
+    Renderer(const Renderer &) = delete;
+
+    Renderer &operator=(const Renderer &) = delete;
+
+    void render(const Grid &grid, const std::string &caption = "");
+
+    void flush();
+};
@@ -0,0 +1,416 @@
+/**
+ * Implements a class for answering queries about a running simulation over a Unix domain socket.
+ *      - Queries are answered from a Snapshot of the world on the server's own thread, see World::snapshot, so
+ *        they never stall the step loop.
+ *          - Snapshots are only taken when a query needs one. The simulation checks a flag between steps, so
+ *            when no query is waiting serving costs a pair of atomic operations per step.
+ *          - A query that reads the cells waits for a snapshot at least as new as the generation being stepped
+ *            when it arrived, which is taken at the next step boundary. A paused simulation publishes a snapshot
+ *            before it waits, so queries about it are answered straight away.
+ *      - Any number of clients may stay connected, the server thread polls all of them.
+ *      - Answers are buffered and written without blocking, a client that stops reading never stalls the server.
+ *
+ *      - The protocol is line based. Each request is a line of text, and each answer is a single line JSON object.
+ *          - GENERATION                The newest generation, and whether the simulation is paused.
+ *                                          {"generation": 120, "paused": false}
+ *          - COUNTS                    The size of the world and its alive and dead cells.
+ *                                          {"generation": 120, "width": 64, "height": 64, "alive": 85, "dead": 4011}
+ *          - BBOX                      The bounding box [x0, x1) by [y0, y1) of the alive cells.
+ *                                          {"generation": 120, "x0": 20, "y0": 18, "x1": 41, "y1": 40}
+ *                                          {"generation": 120, "empty": true}
+ *          - CROP x0 y0 x1 y1          The cells of a window of at most 2^20 cells, one string per row.
+ *                                          {"generation": 120, "width": 3, "height": 2, "rows": [" # ", "###"]}
+ *          - PAUSE                     Pause before the next step.
+ *          - RESUME                    Carry on stepping.
+ *          - STEP n                    Step until generation n, then pause.
+ *                                          {"paused": true, "target": 200}
+ *
+ *      - Requests that cannot be answered get {"error": "..."}.
+ *
+ * @example
+ *
+ *      // Query a simulation started with --serve /tmp/life.sock
+ *      //      printf 'COUNTS\n' | nc -U /tmp/life.sock
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server.h"
+#include "world.h"
+
+namespace {
+    const int MAX_REQUEST = 4096;
+    const long long MAX_CROP = 1 << 20;
+    const std::size_t MAX_OUTPUT = 4 << 20;
+}
+
+/**
+ * QueryServer::QueryServer(path)
+ *
+ * Construct a server listening on a Unix domain socket and start its thread.
+ * A stale socket left at the path by an earlier run is replaced, any other file is left alone.
+ *
+ * @example
+ *
+ *      // Serve a simulation, holding it while paused
+ *      QueryServer server("/tmp/life.sock");
+ *      server.publish(world.snapshot());
+ *      for (int step = 0; step < steps; ++step) {
+ *          server.hold(world);
+ *          world.step();
+ *      }
+ *      server.publish(world.snapshot());
+ *
+ * @param path
+ *      The path to create the socket at.
+ *
+ * @throws
+ *      std::invalid_argument if the path is too long for a socket.
+ *      std::runtime_error if the socket cannot be created.
+ */
+
+QueryServer::QueryServer(const std::string &path)
+        : path(path), listener(-1), wake{-1, -1}, generation(0), requested(false), paused(false), target(0),
+          stopping(false) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Path not valid.");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+
+    struct stat status;
+    if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+        unlink(path.c_str());
+    }
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+        || listen(listener, 16) != 0 || pipe2(wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+        if (listener >= 0) {
+            close(listener);
+        }
+        throw std::runtime_error("Socket not valid.");
+    }
+
+    thread = std::thread(&QueryServer::run, this);
+}
+
+/**
+ * QueryServer::~QueryServer()
+ *
+ * Release a held simulation, stop the server thread, and remove the socket.
+ */
+
+QueryServer::~QueryServer() {
+    stopping.store(true);
+    set_paused(false, 0);
+
+    const char signal = 0;
+    if (write(wake[1], &signal, 1) < 0) {
+        // The thread also stops on its next poll timeout
+    }
+    thread.join();
+
+    close(listener);
+    close(wake[0]);
+    close(wake[1]);
+    unlink(path.c_str());
+}
+
+/**
+ * QueryServer::publish(snapshot)
+ *
+ * Make a snapshot the one queries are answered from, and answer the queries waiting for it.
+ * Never waits for the server thread. Call it from the thread stepping the world, before the first step and after
+ * the last, QueryServer::hold publishes the snapshots in between.
+ *
+ * @param snapshot
+ *      The newest snapshot of the simulation.
+ */
+
+void QueryServer::publish(std::shared_ptr<const Snapshot> snapshot) {
+    if (snapshot->get_generation() > generation.load(std::memory_order_relaxed)) {
+        generation.store(snapshot->get_generation(), std::memory_order_release);
+    }
+    std::atomic_store(&latest, std::move(snapshot));
+
+    const char signal = 0;
+    if (write(wake[1], &signal, 1) < 0) {
+        // A full pipe already has the server thread waking up
+    }
+}
+
+/**
+ * QueryServer::hold(world)
+ *
+ * Call before each step. Publishes a snapshot if a query is waiting for one, then waits while a client has the
+ * simulation paused. When no query is waiting and the simulation is not paused this is a few atomic operations.
+ *
+ * @param world
+ *      The world about to be stepped.
+ */
+
+void QueryServer::hold(World &world) {
+    const int current = world.get_generation();
+    generation.store(current, std::memory_order_release);
+    if (requested.load(std::memory_order_acquire) && requested.exchange(false)) {
+        publish(world.snapshot());
+    }
+
+    if (!paused.load(std::memory_order_acquire) || current < target.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // Nothing is taken while waiting, so leave the held generation published for the queries that come meanwhile
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&latest);
+    if (!snapshot || snapshot->get_generation() != current) {
+        publish(world.snapshot());
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    resumed.wait(lock, [&] {
+        return stopping.load() || !paused.load() || current < target.load();
+    });
+}
+
+/**
+ * QueryServer::ready(request, waiting)
+ *
+ * Private helper that checks whether a request can be answered yet. Requests that read the cells need a snapshot
+ * at least as new as the generation being stepped when they were first checked, kept in waiting, and ask the
+ * simulation for one if the newest is older.
+ */
+
+bool QueryServer::ready(const std::string &request, int &waiting) {
+    std::istringstream words(request);
+    std::string command;
+    words >> command;
+    if (command != "COUNTS" && command != "BBOX" && command != "CROP") {
+        return true;
+    }
+
+    if (waiting < 0) {
+        waiting = generation.load(std::memory_order_acquire);
+    }
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&latest);
+    if (snapshot && snapshot->get_generation() >= waiting) {
+        waiting = -1;
+        return true;
+    }
+    requested.store(true, std::memory_order_release);
+    return false;
+}
+
+/**
+ * QueryServer::set_paused(pause, until)
+ *
+ * Private helper that pauses or resumes the simulation, letting a paused simulation run until a generation.
+ */
+
+void QueryServer::set_paused(bool pause, int until) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        paused.store(pause, std::memory_order_release);
+        target.store(until, std::memory_order_release);
+    }
+    resumed.notify_all();
+}
+
+/**
+ * QueryServer::answer(request)
+ *
+ * Private helper that answers a single request line with a JSON object, see the protocol above.
+ */
+
+std::string QueryServer::answer(const std::string &request) {
+    std::istringstream words(request);
+    std::string command;
+    words >> command;
+
+    std::ostringstream reply;
+
+    if (command == "PAUSE") {
+        set_paused(true, 0);
+        reply << "{\"paused\": true}";
+        return reply.str();
+    }
+    if (command == "RESUME") {
+        set_paused(false, 0);
+        reply << "{\"paused\": false}";
+        return reply.str();
+    }
+    if (command == "STEP") {
+        int until;
+        if (!(words >> until)) {
+            return "{\"error\": \"Generation not valid.\"}";
+        }
+        set_paused(true, until);
+        reply << "{\"paused\": true, \"target\": " << until << "}";
+        return reply.str();
+    }
+
+    if (command == "GENERATION") {
+        reply << "{\"generation\": " << generation.load() << ", \"paused\": " << (paused.load() ? "true" : "false")
+              << "}";
+        return reply.str();
+    }
+
+    // Everything else reads the newest snapshot, which stays alive for as long as it is held here
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&latest);
+    if (!snapshot) {
+        return "{\"error\": \"No generation published yet.\"}";
+    }
+    reply << "{\"generation\": " << snapshot->get_generation();
+
+    if (command == "COUNTS") {
+        const int alive = snapshot->get_alive_cells();
+        reply << ", \"width\": " << snapshot->get_width()
+              << ", \"height\": " << snapshot->get_height()
+              << ", \"alive\": " << alive
+              << ", \"dead\": " << snapshot->get_total_cells() - alive;
+    } else if (command == "BBOX") {
+        int x0, y0, x1, y1;
+        if (snapshot->get_bounds(x0, y0, x1, y1)) {
+            reply << ", \"x0\": " << x0 << ", \"y0\": " << y0 << ", \"x1\": " << x1 << ", \"y1\": " << y1;
+        } else {
+            reply << ", \"empty\": true";
+        }
+    } else if (command == "CROP") {
+        int x0, y0, x1, y1;
+        if (!(words >> x0 >> y0 >> x1 >> y1) || x0 < 0 || y0 < 0 || x1 > snapshot->get_width()
+            || y1 > snapshot->get_height() || x1 < x0 || y1 < y0
+            || (long long) (x1 - x0) * (y1 - y0) > MAX_CROP) {
+            return "{\"error\": \"Crop not valid.\"}";
+        }
+
+        Grid crop = snapshot->crop(x0, y0, x1, y1);
+        reply << ", \"width\": " << crop.get_width() << ", \"height\": " << crop.get_height() << ", \"rows\": [";
+        for (int y = 0; y < crop.get_height(); ++y) {
+            reply << (y == 0 ? "\"" : ", \"");
+            reply.write(reinterpret_cast<const char *>(crop.row(y)), crop.get_width());
+            reply << "\"";
+        }
+        reply << "]";
+    } else {
+        return "{\"error\": \"Command not valid.\"}";
+    }
+
+    reply << "}";
+    return reply.str();
+}
+
+/**
+ * QueryServer::run()
+ *
+ * Private body of the server thread.
+ * Accepts clients, splits what they send into lines, and queues an answer to each.
+ *      - Client sockets never block. Answers wait in a buffer per client and are written out as the client reads
+ *        them, so a slow client only ever delays itself.
+ *      - While more than MAX_OUTPUT bytes of answers wait for a client, no more of its requests are read.
+ *      - A request waiting for a newer snapshot holds up the requests after it from the same client.
+ *      - A client sending a line longer than 4096 bytes is disconnected.
+ */
+
+void QueryServer::run() {
+    struct Client {
+        int socket;
+        std::string input;
+        std::string output;
+        int waiting;
+    };
+    std::vector<Client> clients;
+
+    while (!stopping.load()) {
+        std::vector<pollfd> polled = {{wake[0], POLLIN, 0}, {listener, POLLIN, 0}};
+        for (const Client &client : clients) {
+            short events = client.output.empty() ? 0 : POLLOUT;
+            if (client.output.size() < MAX_OUTPUT && client.input.find('\n') == std::string::npos) {
+                events |= POLLIN;
+            }
+            polled.push_back({client.socket, events, 0});
+        }
+        if (poll(polled.data(), polled.size(), 1000) <= 0) {
+            continue;
+        }
+
+        // Published snapshots only wake the thread, the waiting requests are retried below
+        if (polled[0].revents & POLLIN) {
+            char signals[64];
+            while (read(wake[0], signals, sizeof(signals)) > 0) {
+            }
+        }
+
+        if (polled[1].revents & POLLIN) {
+            int socket = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (socket >= 0) {
+                clients.push_back({socket, "", "", -1});
+            }
+        }
+
+        // Walk the clients backwards so closed ones can be removed in place
+        for (std::size_t i = polled.size() - 1; i >= 2; --i) {
+            const std::size_t index = i - 2;
+            Client &client = clients[index];
+            bool open = (polled[i].revents & (POLLERR | POLLNVAL)) == 0;
+
+            if (open && (polled[i].revents & (POLLIN | POLLHUP))) {
+                char chunk[1024];
+                ssize_t received = recv(client.socket, chunk, sizeof(chunk), 0);
+                if (received > 0) {
+                    client.input.append(chunk, std::size_t(received));
+                } else {
+                    open = received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                }
+            }
+
+            // Answer whole lines until enough output is waiting
+            std::size_t end;
+            while (open && client.output.size() < MAX_OUTPUT
+                   && (end = client.input.find('\n')) != std::string::npos) {
+                std::string request = client.input.substr(0, end);
+                if (!request.empty() && request.back() == '\r') {
+                    request.pop_back();
+                }
+                if (!ready(request, client.waiting)) {
+                    break;
+                }
+                client.input.erase(0, end + 1);
+                client.output += answer(request) + "\n";
+            }
+            open = open && (client.input.size() <= std::size_t(MAX_REQUEST)
+                            || client.input.find('\n') != std::string::npos);
+
+            // Write as much as the client will take without waiting
+            if (open && !client.output.empty()) {
+                ssize_t sent = send(client.socket, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+                if (sent > 0) {
+                    client.output.erase(0, std::size_t(sent));
+                } else {
+                    open = sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                }
+            }
+
+            if (!open) {
+                close(client.socket);
+                clients.erase(clients.begin() + index);
+            }
+        }
+    }
+
+    for (const Client &client : clients) {
+        close(client.socket);
+    }
+}
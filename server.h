@@ -0,0 +1,61 @@
+/**
+ * Declares a class for answering queries about a running simulation over a Unix domain socket.
+ * Rich documentation for the api, protocol and behaviour of the QueryServer class can be found in server.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "snapshot.h"
+
+class World;
+
+/**
+ * Declare the structure of the QueryServer class for serving snapshots of a simulation to local clients.
+ */
+class QueryServer {
+
+private:
+    std::string path;
+    int listener;
+    int wake[2];
+    std::thread thread;
+
+    std::shared_ptr<const Snapshot> latest;
+    std::atomic<int> generation;
+    std::atomic<bool> requested;
+
+    std::atomic<bool> paused;
+    std::atomic<int> target;
+    std::atomic<bool> stopping;
+    std::mutex mutex;
+    std::condition_variable resumed;
+
+    void run();
+
+    bool ready(const std::string &request, int &waiting);
+
+    std::string answer(const std::string &request);
+
+    void set_paused(bool pause, int until);
+
+public:
+    explicit QueryServer(const std::string &path);
+
+    ~QueryServer();
+
+    QueryServer(const QueryServer &) = delete;
+
+    QueryServer &operator=(const QueryServer &) = delete;
+
+    void publish(std::shared_ptr<const Snapshot> snapshot);
+
+    void hold(World &world);
+};
@@ -0,0 +1,262 @@
+/**
+ * Implements a class for an immutable, tiled copy of a world's state, see World::snapshot.
+ *      - The state is split into TILE_SIZE x TILE_SIZE tiles held by shared pointers, with their alive counts.
+ *      - A snapshot shares its tiles with the World that took it and with other snapshots.
+ *          - Taking a snapshot copies one pointer per tile.
+ *          - The World never writes to a tile a snapshot still holds, it replaces the tile with a fresh copy
+ *            instead, so only the tiles that change after a snapshot are ever copied.
+ *
+ *      - Snapshots never change after they are made, so any number of threads may read one without locks.
+ *        Hand the std::shared_ptr from World::snapshot to other threads, for example with std::atomic_store.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <stdexcept>
+#include "snapshot.h"
+
+/**
+ * Snapshot::Snapshot(width, height, generation, tiles)
+ *
+ * Construct a snapshot from its tiles, in row order. Snapshots are made by World::snapshot.
+ *
+ * @param width
+ *      The width of the world.
+ *
+ * @param height
+ *      The height of the world.
+ *
+ * @param generation
+ *      The generation of the world, see World::get_generation.
+ *
+ * @param tiles
+ *      The tiles covering the world, row by row.
+ *
+ * @throws
+ *      std::invalid_argument if the number of tiles does not cover the world.
+ */
+
+Snapshot::Snapshot(int width, int height, int generation, std::vector<std::shared_ptr<const Tile>> tiles)
+        : width(width), height(height), generation(generation), tiles_x((width + TILE_SIZE - 1) / TILE_SIZE),
+          tiles(std::move(tiles)) {
+    if (this->tiles.size() != std::size_t(tiles_x) * ((height + TILE_SIZE - 1) / TILE_SIZE)) {
+        throw std::invalid_argument("Tiles not valid.");
+    }
+}
+
+/**
+ * Snapshot::get_width()
+ *
+ * Gets the width of the snapshot.
+ *
+ * @return
+ *      The width of the world when the snapshot was taken.
+ */
+
+int Snapshot::get_width() const {
+    return width;
+}
+
+/**
+ * Snapshot::get_height()
+ *
+ * Gets the height of the snapshot.
+ *
+ * @return
+ *      The height of the world when the snapshot was taken.
+ */
+
+int Snapshot::get_height() const {
+    return height;
+}
+
+/**
+ * Snapshot::get_generation()
+ *
+ * Gets the generation the snapshot was taken at.
+ *
+ * @return
+ *      The generation of the world when the snapshot was taken.
+ */
+
+int Snapshot::get_generation() const {
+    return generation;
+}
+
+/**
+ * Snapshot::get_total_cells()
+ *
+ * Gets the total number of cells in the snapshot.
+ *
+ * @return
+ *      The width multiplied by the height.
+ */
+
+int Snapshot::get_total_cells() const {
+    return width * height;
+}
+
+/**
+ * Snapshot::get_alive_cells()
+ *
+ * Counts the alive cells from the counts kept with each tile.
+ *
+ * @return
+ *      The number of alive cells in the snapshot.
+ */
+
+int Snapshot::get_alive_cells() const {
+    int alive = 0;
+    for (const auto &tile : tiles) {
+        alive += tile->alive;
+    }
+    return alive;
+}
+
+/**
+ * Snapshot::get(x, y)
+ *
+ * Returns the value of the cell at the desired coordinate.
+ *
+ * @param x
+ *      The x coordinate of the cell.
+ *
+ * @param y
+ *      The y coordinate of the cell.
+ *
+ * @return
+ *      The value of the cell, Cell::ALIVE or Cell::DEAD.
+ *
+ * @throws
+ *      std::runtime_error if x,y is not a valid coordinate within the snapshot.
+ */
+
+Cell Snapshot::get(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+        throw std::runtime_error("Coordinates not valid.");
+    }
+    const Tile &tile = *tiles[(y / TILE_SIZE) * tiles_x + x / TILE_SIZE];
+    return tile.cells[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+}
+
+/**
+ * Snapshot::get_bounds(x0, y0, x1, y1)
+ *
+ * Find the bounding box of the alive cells, scanning only the tiles that hold any.
+ *
+ * @param x0
+ *      Set to the left edge of the box.
+ *
+ * @param y0
+ *      Set to the top edge of the box.
+ *
+ * @param x1
+ *      Set to 1 greater than the right edge of the box.
+ *
+ * @param y1
+ *      Set to 1 greater than the bottom edge of the box.
+ *
+ * @return
+ *      False if no cells are alive, leaving the box unchanged.
+ */
+
+bool Snapshot::get_bounds(int &x0, int &y0, int &x1, int &y1) const {
+    int left = width;
+    int top = height;
+    int right = 0;
+    int bottom = 0;
+
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        const Tile &tile = *tiles[i];
+        if (tile.alive == 0) {
+            continue;
+        }
+        const int tile_x = int(i % tiles_x) * TILE_SIZE;
+        const int tile_y = int(i / tiles_x) * TILE_SIZE;
+        for (int y = 0; y < TILE_SIZE; ++y) {
+            for (int x = 0; x < TILE_SIZE; ++x) {
+                if (tile.cells[y * TILE_SIZE + x] == Cell::ALIVE) {
+                    left = std::min(left, tile_x + x);
+                    top = std::min(top, tile_y + y);
+                    right = std::max(right, tile_x + x + 1);
+                    bottom = std::max(bottom, tile_y + y + 1);
+                }
+            }
+        }
+    }
+
+    if (right == 0) {
+        return false;
+    }
+    x0 = left;
+    y0 = top;
+    x1 = right;
+    y1 = bottom;
+    return true;
+}
+
+/**
+ * Snapshot::crop(x0, y0, x1, y1)
+ *
+ * Copy a window of the snapshot into a grid, touching only the tiles the window covers.
+ * The cropped grid spans the range [x0, x1) by [y0, y1), matching Grid::crop.
+ *
+ * @example
+ *
+ *      // Copy the top left 16x16 cells of the newest snapshot
+ *      std::shared_ptr<const Snapshot> snapshot = world.snapshot();
+ *      Grid corner = snapshot->crop(0, 0, 16, 16);
+ *
+ * @param x0
+ *      Left coordinate of the crop window on x-axis.
+ *
+ * @param y0
+ *      Top coordinate of the crop window on y-axis.
+ *
+ * @param x1
+ *      Right coordinate of the crop window on x-axis (1 greater than the largest index).
+ *
+ * @param y1
+ *      Bottom coordinate of the crop window on y-axis (1 greater than the largest index).
+ *
+ * @return
+ *      A new grid of the cropped size.
+ *
+ * @throws
+ *      std::range_error if the window is not within the snapshot or has a negative size.
+ */
+
+Grid Snapshot::crop(int x0, int y0, int x1, int y1) const {
+    if (x0 < 0 || y0 < 0 || x1 > width || y1 > height || x1 < x0 || y1 < y0) {
+        throw std::range_error("Grid is not in the required ranges.");
+    }
+
+    Grid grid(x1 - x0, y1 - y0);
+    for (int y = y0; y < y1; ++y) {
+        Cell *row = grid.row(y - y0);
+
+        // Copy the row a tile at a time
+        for (int x = x0; x < x1;) {
+            const int end = std::min(x1, (x / TILE_SIZE + 1) * TILE_SIZE);
+            const Tile &tile = *tiles[(y / TILE_SIZE) * tiles_x + x / TILE_SIZE];
+            const Cell *source = tile.cells.data() + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+            std::copy(source, source + (end - x), row + (x - x0));
+            x = end;
+        }
+    }
+    return grid;
+}
+
+/**
+ * Snapshot::to_grid()
+ *
+ * Copy the whole snapshot into a grid.
+ *
+ * @return
+ *      A new grid holding the state of the world when the snapshot was taken.
+ */
+
+Grid Snapshot::to_grid() const {
+    return crop(0, 0, width, height);
+}
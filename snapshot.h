@@ -0,0 +1,57 @@
+/**
+ * Declares a class for an immutable, tiled copy of a world's state that can be read from any thread.
+ * Rich documentation for the api and behaviour the Snapshot class can be found in snapshot.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the structure of the Snapshot class for sharing a generation between threads.
+ */
+class Snapshot {
+
+public:
+    static constexpr int TILE_SIZE = 64;
+
+    /**
+     * A TILE_SIZE x TILE_SIZE block of cells in row order, cells past the edge of the world are dead.
+     */
+    struct Tile {
+        std::vector<Cell> cells = std::vector<Cell>(TILE_SIZE * TILE_SIZE, Cell::DEAD);
+        int alive = 0;
+    };
+
+private:
+    int width;
+    int height;
+    int generation;
+    int tiles_x;
+    std::vector<std::shared_ptr<const Tile>> tiles;
+
+public:
+    explicit Snapshot(int width, int height, int generation, std::vector<std::shared_ptr<const Tile>> tiles);
+
+    int get_width() const;
+
+    int get_height() const;
+
+    int get_generation() const;
+
+    int get_total_cells() const;
+
+    int get_alive_cells() const;
+
+    Cell get(int x, int y) const;
+
+    bool get_bounds(int &x0, int &y0, int &x1, int &y1) const;
+
+    Grid crop(int x0, int y0, int x1, int y1) const;
+
+    Grid to_grid() const;
+};
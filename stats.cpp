@@ -0,0 +1,382 @@
+/**
+ * Implements a class for streaming per-generation statistics of a simulation.
+ *      - Rows are written for every window of generations, as CSV with a header line, or as JSON lines
+ *        when the path ends in .json or .jsonl.
+ *      - Each row holds:
+ *          - generation        The generation reached at the end of the window.
+ *          - generations       The number of generations stepped in the window, 0 for the closing row.
+ *          - step_seconds      The wall time spent in World::step.
+ *          - cells_per_second  The world cells advanced per second of stepping.
+ *          - alive             The number of alive cells at the end of the window.
+ *          - births, deaths    The cells that were born and died over the window.
+ *          - changed           The births and deaths together.
+ *          - stepped           The cells World::step evaluated, the rest were skipped outside the live box.
+ *          - allocations       The heap allocations made during the window, and their total bytes.
+ *          - io_seconds        The wall time the stepping thread spent loading and saving, reported by record_io.
+ *                              Game_of_Life reports loading the input or the checkpoint it resumes from and saving
+ *                              the output, so only the first and last rows hold any. Checkpoints, recordings and
+ *                              frames are written on their own threads while the world steps and are not included.
+ *          - engine            The engine stepping the world at the end of the window, see World::set_engine.
+ *
+ *      - With hardware counters enabled each row also holds, per generation and per cell of the world, the cycles,
+ *        instructions, L1 and last level cache misses, branch misses and data TLB misses of World::step, read with
+ *        PerfCounters. Counters the machine does not allow are left empty in CSV and null in JSON lines.
+ *          - The counters are opened by the first Stats::start_step, so they count the stepping thread and the
+ *            threads it starts from then on, such as an engine's workers. Threads started before the first step,
+ *            like the renderer, pipeline consumers and query server, and the threads those start, are not counted.
+ *
+ *      - Heap allocations are counted by replacing the global operator new. Counting only happens while a
+ *        Stats object exists, otherwise the replacement costs a single relaxed atomic load per allocation.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include "stats.h"
+
+namespace {
+    std::atomic<bool> counting(false);
+    std::atomic<long long> allocation_count(0);
+    std::atomic<long long> allocation_bytes(0);
+
+    /**
+     * allocate(size)
+     *
+     * Allocate memory for the replaced operator new, counting it while a Stats object exists.
+     */
+
+    void *allocate(std::size_t size) {
+        if (counting.load(std::memory_order_relaxed)) {
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+            allocation_bytes.fetch_add((long long) size, std::memory_order_relaxed);
+        }
+        void *memory = std::malloc(size == 0 ? 1 : size);
+        if (memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+}
+
+void *operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+/**
+ * Stats::Stats(path, window = 1, hardware_counters = false)
+ *
+ * Construct a statistics stream writing to a file and start counting heap allocations.
+ * CSV files start with a header line naming the columns.
+ * If hardware counters are asked for they are opened by the first Stats::start_step, and if none can be opened a
+ * warning is printed then and their columns stay empty.
+ *
+ * @example
+ *
+ *      // Write a JSON line for every 10 generations
+ *      Stats stats("run.jsonl", 10);
+ *
+ * @param path
+ *      The file to write to, a path ending in .json or .jsonl writes JSON lines, anything else writes CSV.
+ *
+ * @param window
+ *      Optional parameter. The number of generations summarised by each row. Defaults to 1.
+ *
+ * @param hardware_counters
+ *      Optional parameter. If true rows also hold hardware performance counters. Defaults to false.
+ *
+ * @throws
+ *      std::invalid_argument if the window is not positive or the file cannot be opened.
+ */
+
+Stats::Stats(const std::string &path, int window, bool hardware_counters)
+        : file(path), json(false), window(window), generations(0), step_seconds(0), cells(0), stepped(0),
+          births(0), deaths(0), io_seconds(0), allocations(get_allocations()),
+          allocated_bytes(get_allocated_bytes()), hardware_counters(hardware_counters), counted(),
+          step_start_counts() {
+    if (window <= 0) {
+        throw std::invalid_argument("Window not valid.");
+    }
+    if (!file) {
+        throw std::invalid_argument("File not found.");
+    }
+
+    auto ends_with = [&path](const std::string &suffix) {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    json = ends_with(".json") || ends_with(".jsonl");
+
+    if (!json) {
+        file << "generation,generations,step_seconds,cells_per_second,alive,births,deaths,changed,stepped,"
+                "allocations,allocated_bytes,io_seconds,engine";
+        for (int counter = 0; hardware_counters && counter < PerfCounters::COUNTERS; ++counter) {
+            const char *name = PerfCounters::get_name(PerfCounters::Counter(counter));
+            file << ',' << name << "_per_generation," << name << "_per_cell";
+        }
+        file << '\n';
+    }
+    counting.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * Stats::~Stats()
+ *
+ * Stop counting heap allocations and close the file.
+ */
+
+Stats::~Stats() {
+    counting.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * Stats::write_row(generation, world)
+ *
+ * Private helper that writes the totals of the current window and starts a new one.
+ */
+
+void Stats::write_row(int generation, const World &world) {
+    const long long window_allocations = get_allocations() - allocations;
+    const long long window_bytes = get_allocated_bytes() - allocated_bytes;
+    const double cells_per_second = step_seconds > 0 ? double(cells) / step_seconds : 0;
+
+    if (json) {
+        file << "{\"generation\": " << generation
+             << ", \"generations\": " << generations
+             << ", \"step_seconds\": " << step_seconds
+             << ", \"cells_per_second\": " << cells_per_second
+             << ", \"alive\": " << world.get_alive_cells()
+             << ", \"births\": " << births
+             << ", \"deaths\": " << deaths
+             << ", \"changed\": " << births + deaths
+             << ", \"stepped\": " << stepped
+             << ", \"allocations\": " << window_allocations
+             << ", \"allocated_bytes\": " << window_bytes
+             << ", \"io_seconds\": " << io_seconds
+             << ", \"engine\": \"" << world.get_engine() << "\"";
+    } else {
+        file << generation << ',' << generations << ',' << step_seconds << ',' << cells_per_second << ','
+             << world.get_alive_cells() << ',' << births << ',' << deaths << ',' << births + deaths << ','
+             << stepped << ',' << window_allocations << ',' << window_bytes << ',' << io_seconds << ','
+             << world.get_engine();
+    }
+
+    for (int counter = 0; hardware_counters && counter < PerfCounters::COUNTERS; ++counter) {
+        const std::string name = PerfCounters::get_name(PerfCounters::Counter(counter));
+        const long long count = counted.values[counter];
+        const bool missing = count < 0 || generations == 0;
+
+        if (json) {
+            file << ", \"" << name << "_per_generation\": ";
+            if (missing) {
+                file << "null";
+            } else {
+                file << double(count) / generations;
+            }
+            file << ", \"" << name << "_per_cell\": ";
+            if (missing || cells == 0) {
+                file << "null";
+            } else {
+                file << double(count) / cells;
+            }
+        } else {
+            file << ',';
+            if (!missing) {
+                file << double(count) / generations;
+            }
+            file << ',';
+            if (!missing && cells > 0) {
+                file << double(count) / cells;
+            }
+        }
+        counted.values[counter] = 0;
+    }
+    file << (json ? "}\n" : "\n");
+
+    generations = 0;
+    step_seconds = 0;
+    cells = 0;
+    stepped = 0;
+    births = 0;
+    deaths = 0;
+    io_seconds = 0;
+    allocations = get_allocations();
+    allocated_bytes = get_allocated_bytes();
+}
+
+/**
+ * Stats::start_step()
+ *
+ * Note the time, and the hardware counters if enabled, at the start of a step.
+ * Pair with Stats::finish_step after World::step, called from the thread stepping the world.
+ * The first call opens the hardware counters, start any threads that should not be counted before it.
+ *
+ * @example
+ *
+ *      // Measure a step
+ *      stats.start_step();
+ *      world.step();
+ *      stats.finish_step(1, world);
+ */
+
+void Stats::start_step() {
+    if (hardware_counters && !counters) {
+        counters = std::make_unique<PerfCounters>();
+        if (!counters->is_available()) {
+            std::cerr << "Hardware performance counters are not available, their statistics will be empty."
+                      << std::endl;
+        }
+    }
+    if (counters) {
+        step_start_counts = counters->read();
+    }
+    step_start = std::chrono::steady_clock::now();
+}
+
+/**
+ * Stats::finish_step(generation, world)
+ *
+ * Record the step started by Stats::start_step, see Stats::record_step.
+ *
+ * @param generation
+ *      The generation the step produced.
+ *
+ * @param world
+ *      The world that was stepped.
+ */
+
+void Stats::finish_step(int generation, const World &world) {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - step_start).count();
+    if (counters) {
+        PerfCounters::Sample used = PerfCounters::difference(counters->read(), step_start_counts);
+        record_step(generation, seconds, world, &used);
+    } else {
+        record_step(generation, seconds, world);
+    }
+}
+
+/**
+ * Stats::record_step(generation, seconds, world, hardware_counts = nullptr)
+ *
+ * Add a step of the world to the current window, writing a row when the window is full.
+ * The births, deaths and stepped cells are read from the world, so call this straight after World::step.
+ *
+ * @example
+ *
+ *      // Time a step and record it
+ *      auto start = std::chrono::steady_clock::now();
+ *      world.step();
+ *      stats.record_step(1, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), world);
+ *
+ * @param generation
+ *      The generation the step produced.
+ *
+ * @param seconds
+ *      The wall time the step took.
+ *
+ * @param world
+ *      The world that was stepped.
+ *
+ * @param hardware_counts
+ *      Optional parameter. The hardware counts of the step, a counter missing from any step in a window leaves
+ *      it empty for the window. Defaults to nullptr, recording no counts.
+ */
+
+void Stats::record_step(int generation, double seconds, const World &world,
+                        const PerfCounters::Sample *hardware_counts) {
+    for (int counter = 0; hardware_counts && counter < PerfCounters::COUNTERS; ++counter) {
+        const long long count = hardware_counts->values[counter];
+        counted.values[counter] = (count < 0 || counted.values[counter] < 0) ? -1 : counted.values[counter] + count;
+    }
+
+    generations++;
+    step_seconds += seconds;
+    cells += world.get_total_cells();
+    stepped += world.get_stepped_cells();
+    births += world.get_births();
+    deaths += world.get_deaths();
+
+    if (generations >= window) {
+        write_row(generation, world);
+    }
+}
+
+/**
+ * Stats::record_io(seconds)
+ *
+ * Add time the stepping thread spent loading or saving to the current window.
+ * Time spent on other threads overlaps the steps, so it should not be reported here.
+ *
+ * @param seconds
+ *      The wall time the load or save took.
+ */
+
+void Stats::record_io(double seconds) {
+    io_seconds += seconds;
+}
+
+/**
+ * Stats::close(generation, world)
+ *
+ * Write the remains of the current window, including any I/O and allocations since the last row, and flush
+ * the file. A window with no steps is written with 0 generations.
+ *
+ * @param generation
+ *      The final generation of the simulation.
+ *
+ * @param world
+ *      The simulated world.
+ */
+
+void Stats::close(int generation, const World &world) {
+    write_row(generation, world);
+    file.flush();
+}
+
+/**
+ * Stats::get_allocations()
+ *
+ * Gets the number of heap allocations counted while any Stats object existed.
+ *
+ * @return
+ *      The number of counted calls to operator new.
+ */
+
+long long Stats::get_allocations() {
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+/**
+ * Stats::get_allocated_bytes()
+ *
+ * Gets the number of heap bytes requested while any Stats object existed.
+ *
+ * @return
+ *      The number of bytes requested from operator new.
+ */
+
+long long Stats::get_allocated_bytes() {
+    return allocation_bytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+/**
+ * Declares a class for streaming per-generation statistics of a simulation as CSV or JSON lines.
+ * Rich documentation for the api and behaviour the Stats class can be found in stats.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "perf.h"
+#include "world.h"
+
+/**
+ * Declare the structure of the Stats class for recording where the time of a simulation goes.
+ */
+class Stats {
+
+private:
+    std::ofstream file;
+    bool json;
+    int window;
+
+    int generations;
+    double step_seconds;
+    long long cells;
+    long long stepped;
+    long long births;
+    long long deaths;
+    double io_seconds;
+    long long allocations;
+    long long allocated_bytes;
+
+    bool hardware_counters;
+    std::unique_ptr<PerfCounters> counters;
+    PerfCounters::Sample counted;
+    PerfCounters::Sample step_start_counts;
+    std::chrono::steady_clock::time_point step_start;
+
+    void write_row(int generation, const World &world);
+
+public:
+    explicit Stats(const std::string &path, int window = 1, bool hardware_counters = false);
+
+    ~Stats();
+
+    Stats(const Stats &) = delete;
+
+    Stats &operator=(const Stats &) = delete;
+
+    void start_step();
+
+    void finish_step(int generation, const World &world);
+
+    void record_step(int generation, double seconds, const World &world,
+                     const PerfCounters::Sample *hardware_counts = nullptr);
+
+    void record_io(double seconds);
+
+    void close(int generation, const World &world);
+
+    static long long get_allocations();
+
+    static long long get_allocated_bytes();
+};
@@ -0,0 +1,236 @@
+/**
+ * Implements a class for watching a running simulation live in a terminal.
+ *      - The grid is downsampled to fit the terminal.
+ *          - Braille glyphs draw 2x4 dots per character, half block glyphs draw 1x2.
+ *          - When the grid is larger than the terminal each dot covers a square block of cells,
+ *            and is lit when the fraction of alive cells in the block reaches the density threshold.
+ *
+ *      - Only characters that changed since the last frame are redrawn, using ANSI cursor moves,
+ *        so the bytes written per frame follow the visual change rather than the size of the world.
+ *          - A status line below the view shows the generation, population, and scale.
+ *
+ *      - Frames are capped to a maximum rate independent of the simulation rate.
+ *        Calls to Viewer::show that arrive too soon after the last frame return immediately.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#include <algorithm>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "viewer.h"
+
+namespace {
+
+    /**
+     * Append the UTF-8 encoding of a code point in the basic multilingual plane.
+     */
+    void append_utf8(std::string &buffer, std::uint32_t code) {
+        if (code < 0x80) {
+            buffer += char(code);
+        } else {
+            buffer += char(0xE0 | (code >> 12));
+            buffer += char(0x80 | ((code >> 6) & 0x3F));
+            buffer += char(0x80 | (code & 0x3F));
+        }
+    }
+
+    /**
+     * Write a whole buffer to standard output, retrying short writes.
+     */
+    void write_all(const std::string &buffer) {
+        const char *data = buffer.data();
+        std::size_t size = buffer.size();
+
+        while (size > 0) {
+            ssize_t written = ::write(STDOUT_FILENO, data, size);
+            if (written <= 0) {
+                return;
+            }
+            data += written;
+            size -= std::size_t(written);
+        }
+    }
+}
+
+/**
+ * Viewer::Viewer(glyphs = BRAILLE, fps = 30, threshold = 0.25)
+ *
+ * Construct a viewer drawing to the terminal on standard output.
+ *
+ * @example
+ *
+ *      // Watch a world at no more than 20 frames per second
+ *      Viewer viewer(Viewer::BRAILLE, 20.0);
+ *      for (int step = 1; step <= 1000; ++step) {
+ *          world.step();
+ *          viewer.show(world.get_state(), step);
+ *      }
+ *
+ * @param glyphs
+ *      Optional parameter. The glyphs used to draw cells. Defaults to Viewer::BRAILLE.
+ *
+ * @param fps
+ *      Optional parameter. The maximum number of frames drawn per second. Defaults to 30.
+ *
+ * @param threshold
+ *      Optional parameter. The fraction of alive cells a downsampled block needs to be drawn lit. Defaults to 0.25.
+ */
+
+Viewer::Viewer(Glyphs glyphs, double fps, double threshold)
+        : glyphs(glyphs), threshold(threshold),
+          frame_interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>(fps > 0.0 ? 1.0 / fps : 0.0))),
+          drawn(false), columns(0), rows(0) {}
+
+/**
+ * Viewer::~Viewer()
+ *
+ * Restore the cursor and move it below the view.
+ */
+
+Viewer::~Viewer() {
+    if (drawn) {
+        write_all("\x1b[" + std::to_string(rows + 2) + ";1H\x1b[?25h");
+    }
+}
+
+/**
+ * Viewer::show(grid, generation, force = false)
+ *
+ * Draw a frame of the grid, unless the last frame was drawn less than a frame interval ago.
+ *
+ * @param grid
+ *      The grid, or view of a grid, to draw.
+ *
+ * @param generation
+ *      The generation shown in the status line.
+ *
+ * @param force
+ *      Optional parameter. If true the frame is drawn regardless of the frame rate cap. Defaults to false.
+ */
+
+void Viewer::show(ConstGridView grid, int generation, bool force) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (!force && drawn && now - last_frame < frame_interval) {
+        return;
+    }
+
+    last_frame = now;
+    draw(grid, generation);
+}
+
+/**
+ * Viewer::draw(grid, generation)
+ *
+ * Private helper function to downsample the grid and write the characters that changed.
+ */
+
+void Viewer::draw(ConstGridView grid, int generation) {
+    buffer.clear();
+
+    // Fit the view to the terminal, leaving a line for the status.
+    winsize size{};
+    int terminal_columns = 80;
+    int terminal_rows = 24;
+    if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 1) {
+        terminal_columns = size.ws_col;
+        terminal_rows = size.ws_row;
+    }
+
+    int dots_x = (glyphs == Glyphs::BRAILLE) ? 2 : 1;
+    int dots_y = (glyphs == Glyphs::BRAILLE) ? 4 : 2;
+
+    // One dot covers a scale by scale block of cells, keeping the aspect ratio of the grid.
+    int scale = std::max({1, (grid.get_width() + terminal_columns * dots_x - 1) / (terminal_columns * dots_x),
+                          (grid.get_height() + (terminal_rows - 1) * dots_y - 1) / ((terminal_rows - 1) * dots_y)});
+
+    int dot_width = (grid.get_width() + scale - 1) / scale;
+    int dot_height = (grid.get_height() + scale - 1) / scale;
+    int view_columns = (dot_width + dots_x - 1) / dots_x;
+    int view_rows = (dot_height + dots_y - 1) / dots_y;
+
+    // Start from a clear screen when the view changes shape.
+    if (!drawn || view_columns != columns || view_rows != rows) {
+        buffer += "\x1b[?25l\x1b[2J";
+        columns = view_columns;
+        rows = view_rows;
+        previous.assign(std::size_t(columns) * rows, 0xFFFF);
+        status.clear();
+        drawn = true;
+    }
+
+    // Aggregate alive cells into per dot counts, reading the grid one row at a time.
+    counts.assign(std::size_t(dot_width) * dot_height, 0);
+    int population = 0;
+    for (int y = 0; y < grid.get_height(); ++y) {
+        const Cell *cells = grid.row(y);
+        int *line = &counts[std::size_t(y / scale) * dot_width];
+        for (int x = 0; x < grid.get_width(); ++x) {
+            if (cells[x] == Cell::ALIVE) {
+                line[x / scale]++;
+                population++;
+            }
+        }
+    }
+
+    int lit = std::max(1, int(threshold * scale * scale + 0.5));
+
+    // Emit only the characters that differ from the last frame, moving the cursor only when needed.
+    int cursor_row = -1;
+    int cursor_column = -1;
+
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+
+            std::uint16_t code = 0;
+            for (int dy = 0; dy < dots_y; ++dy) {
+                for (int dx = 0; dx < dots_x; ++dx) {
+                    int dot_x = column * dots_x + dx;
+                    int dot_y = row * dots_y + dy;
+                    if (dot_x < dot_width && dot_y < dot_height
+                        && counts[std::size_t(dot_y) * dot_width + dot_x] >= lit) {
+                        if (glyphs == Glyphs::BRAILLE) {
+                            static const std::uint16_t braille[4][2] = {{0x01, 0x08}, {0x02, 0x10},
+                                                                        {0x04, 0x20}, {0x40, 0x80}};
+                            code |= braille[dy][dx];
+                        } else {
+                            code |= std::uint16_t(1 << dy);
+                        }
+                    }
+                }
+            }
+
+            std::uint16_t &old = previous[std::size_t(row) * columns + column];
+            if (old == code) {
+                continue;
+            }
+            old = code;
+
+            if (cursor_row != row || cursor_column != column) {
+                buffer += "\x1b[" + std::to_string(row + 1) + ";" + std::to_string(column + 1) + "H";
+            }
+
+            if (glyphs == Glyphs::BRAILLE) {
+                append_utf8(buffer, code ? 0x2800u + code : ' ');
+            } else {
+                static const std::uint32_t half_blocks[4] = {' ', 0x2580, 0x2584, 0x2588};
+                append_utf8(buffer, half_blocks[code]);
+            }
+
+            cursor_row = row;
+            cursor_column = column + 1;
+        }
+    }
+
+    std::string line = "Generation " + std::to_string(generation) + " | Alive " + std::to_string(population)
+                       + " | " + std::to_string(grid.get_width()) + "x" + std::to_string(grid.get_height())
+                       + " at 1:" + std::to_string(scale);
+    if (line != status) {
+        buffer += "\x1b[" + std::to_string(rows + 1) + ";1H\x1b[2K" + line;
+        status = line;
+    }
+
+    write_all(buffer);
+}
@@ -0,0 +1,56 @@
+/**
+ * Declares a class for watching a running simulation live in a terminal.
+ * Rich documentation for the api and behaviour the Viewer class can be found in viewer.cpp.
+ *
+ * @author 958753
+ * @date March, 2020
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "grid.h"
+
+/**
+ * Declare the structure of the Viewer class for drawing a downsampled, incrementally updated view of a grid.
+ */
+class Viewer {
+
+public:
+    /**
+     * The glyphs used to draw cells, braille packs 2x4 dots into a character, half blocks pack 1x2.
+     */
+    enum Glyphs {
+        BRAILLE,
+        HALF_BLOCK
+    };
+
+private:
+    Glyphs glyphs;
+    double threshold;
+    std::chrono::steady_clock::duration frame_interval;
+    std::chrono::steady_clock::time_point last_frame;
+    bool drawn;
+
+    int columns;
+    int rows;
+    std::vector<std::uint16_t> previous;
+    std::vector<int> counts;
+    std::string status;
+    std::string buffer;
+
+    void draw(ConstGridView grid, int generation);
+
+public:
+    explicit Viewer(Glyphs glyphs = Glyphs::BRAILLE, double fps = 30.0, double threshold = 0.25);
+
+    ~Viewer();
+
+    Viewer(const Viewer &) = delete;
+
+    Viewer &operator=(const Viewer &) = delete;
+
+    void show(ConstGridView grid, int generation, bool force = false);
+};
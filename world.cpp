@@ -18,6 +18,19 @@
  *          - Moving off the left edge you appear on the right edge and vice versa.
  *          - Moving off the top edge you appear on the bottom edge and vice versa.
  *
+ *      - Worlds can hand stepping to a named Engine, or tune themselves to the fastest one with "auto".
+ *
+ *      - Worlds can optionally grow to follow a pattern instead of killing cells at the edges.
+ *          - Re-centring is tracked by an offset so positions can be reported in stable coordinates.
+ *
+ *      - Worlds count their generations and can hand out immutable snapshots of their state to other threads.
+ *          - Snapshots are tiled and share their tiles with the world, a tile is only copied when it changes
+ *            while a snapshot still holds it. See snapshot.cpp.
+ *
+ *      - Worlds can be walked generation by generation as a lazy range, stepping only as the range is advanced.
+ *
+ *      - Worlds can advance on a background thread, with progress reports and cancellation between steps.
+ *
  * @author 958753
  * @date March, 2020
  */
@@ -27,6 +40,16 @@
 // Include the minimal number of headers needed to support your implementation.
 // #include ...
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
 /**
  * World::World()
  *
@@ -190,6 +213,7 @@ int World::get_total_cells() const {
  * World::get_alive_cells()
  *
  * Counts how many cells in the world are alive.
+ * The count is kept up to date by World::step, so after the first step this does not scan the grid.
  * The function should be callable from a constant context.
  *
  * @example
@@ -211,7 +235,7 @@ int World::get_total_cells() const {
  */
 
 int World::get_alive_cells() const {
-    return current_state.get_alive_cells();
+    return occupancy_known ? population : current_state.get_alive_cells();
 }
 
 /**
@@ -239,7 +263,7 @@ int World::get_alive_cells() const {
  */
 
 int World::get_dead_cells() const {
-    return current_state.get_dead_cells();
+    return get_total_cells() - get_alive_cells();
 }
 
 
@@ -273,6 +297,204 @@ const Grid &World::get_state() const {
 }
 
 
+/**
+ * World::get_births()
+ *
+ * Gets the number of dead cells that became alive in the last step.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Step a world and print how many cells were born
+ *      World world(Zoo::r_pentomino());
+ *      world.step();
+ *      std::cout << world.get_births() << std::endl;
+ *
+ * @return
+ *      The number of births in the last step, 0 before the first step.
+ */
+
+int World::get_births() const {
+    if (!changes_known) {
+        count_changes();
+    }
+    return last_births;
+}
+
+/**
+ * World::get_deaths()
+ *
+ * Gets the number of alive cells that died in the last step.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The number of deaths in the last step, 0 before the first step.
+ */
+
+int World::get_deaths() const {
+    if (!changes_known) {
+        count_changes();
+    }
+    return last_deaths;
+}
+
+/**
+ * World::get_stepped_cells()
+ *
+ * Gets the number of cells the last step actually evaluated, the area of the live box expanded by one cell.
+ * Compared to World::get_total_cells this shows how much of the world the bounding box let the step skip.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The number of cells evaluated in the last step, 0 before the first step.
+ */
+
+long long World::get_stepped_cells() const {
+    return last_stepped;
+}
+
+/**
+ * World::set_engine(name, retune_every = 0)
+ *
+ * Choose how World::step computes the next generation.
+ *      "reference" uses the World's own implementation, the default.
+ *      Any name registered with Engine, such as "rowsum" or "threaded:4", hands the step to that engine.
+ *      "auto" picks the fastest of Engine::get_candidates for the actual state with Engine::tune on the next
+ *      step, and again every retune_every steps after that if it is positive.
+ * Auto-grow, the counts and the rules are the same whichever engine is used.
+ *
+ * @example
+ *
+ *      // Let the world pick its own engine and reconsider every 1000 generations
+ *      World world(grid);
+ *      world.set_engine("auto", 1000);
+ *
+ * @param name
+ *      The engine to use.
+ *
+ * @param retune_every
+ *      Optional parameter. For "auto", the number of steps between re-tuning, 0 tunes only once. Defaults to 0.
+ *
+ * @throws
+ *      std::invalid_argument if the engine is not "reference", "auto" or a registered engine.
+ */
+
+void World::set_engine(const std::string &name, int retune_every) {
+    auto_engine = name == "auto";
+    this->retune_every = retune_every;
+    since_tune = -1;
+
+    if (auto_engine || name == "reference") {
+        engine.reset();
+    } else {
+        engine = Engine::create(name);
+    }
+}
+
+/**
+ * World::get_engine()
+ *
+ * Gets the name of the engine stepping the world, after "auto" this is the engine it chose.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The engine name, "reference" for the World's own implementation.
+ */
+
+std::string World::get_engine() const {
+    return engine ? engine->get_name() : "reference";
+}
+
+/**
+ * World::set_auto_grow(margin, shrink)
+ *
+ * Let the world grow to follow the pattern when stepping without a torus.
+ * Before each non-toroidal step, if any alive cell is closer than margin cells to an edge the pattern is
+ * re-centred, and any dimension that is less than twice the size the pattern needs (its bounding box plus
+ * the margin on both sides) is grown to at least double its size. Doubling keeps the total copying
+ * amortised O(1) per cell of growth.
+ * If shrink is true, a dimension more than four times the size the pattern needs is shrunk back to twice
+ * the size it needs.
+ *
+ * Cells are moved when the grid is re-centred, the moves are tracked by World::get_offset_x() and
+ * World::get_offset_y() so positions can be reported in stable coordinates.
+ * Toroidal steps never grow the world.
+ *
+ * @example
+ *
+ *      // Make a small world that follows a glider forever
+ *      World world(Zoo::glider());
+ *      world.set_auto_grow(2);
+ *      world.advance(1000);
+ *
+ * @param margin
+ *      The number of cells to keep clear between the pattern and the edges, 0 disables auto-grow.
+ *
+ * @param shrink
+ *      Optional parameter. If true the world also shrinks when the pattern contracts. Defaults to false.
+ *
+ * @throws
+ *      std::invalid_argument if the margin is negative.
+ */
+
+void World::set_auto_grow(int margin, bool shrink) {
+    if (margin < 0) {
+        throw std::invalid_argument("Margin not valid.");
+    }
+    grow_margin = margin;
+    grow_shrink = shrink;
+}
+
+/**
+ * World::get_offset_x()
+ *
+ * Gets the stable x coordinate of column 0 of the current state.
+ * The offset starts at 0 and changes only when auto-grow re-centres the world, a cell at column x of
+ * World::get_state() is at x + World::get_offset_x() in stable coordinates.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The x offset of the current state.
+ */
+
+int World::get_offset_x() const {
+    return offset_x;
+}
+
+/**
+ * World::get_offset_y()
+ *
+ * Gets the stable y coordinate of row 0 of the current state.
+ * The offset starts at 0 and changes only when auto-grow re-centres the world, a cell at row y of
+ * World::get_state() is at y + World::get_offset_y() in stable coordinates.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The y offset of the current state.
+ */
+
+int World::get_offset_y() const {
+    return offset_y;
+}
+
+/**
+ * World::set_offset(x, y)
+ *
+ * Sets the stable coordinates of the top left cell of the current state, for a world resumed from a saved state.
+ *
+ * @param x
+ *      The x offset of the current state, see World::get_offset_x.
+ *
+ * @param y
+ *      The y offset of the current state, see World::get_offset_y.
+ */
+
+void World::set_offset(int x, int y) {
+    offset_x = x;
+    offset_y = y;
+}
+
+
 /**
  * World::resize(square_size)
  *
@@ -322,6 +544,12 @@ void World::resize(int square_size) {
 
 void World::resize(int width, int height) {
     current_state.resize(width, height);
+    tiles.clear();
+    dirty_tiles.clear();
+    occupancy_known = false;
+    changes_known = true;
+    last_births = 0;
+    last_deaths = 0;
 }
 
 /**
@@ -410,6 +638,310 @@ int World::count_neighbours(int x_cent, int y_cent, bool toroidal) {
     return counter;
 }
 
+/**
+ * World::find_occupancy()
+ *
+ * Private helper that marks which rows and columns of the current state hold an alive cell, and counts them.
+ * World::step keeps the marks up to date as it writes each generation, they only need to be found
+ * again after the current state is replaced, for example by World::resize.
+ */
+
+void World::find_occupancy() {
+    live_columns.assign(current_state.get_width(), 0);
+    live_rows.assign(current_state.get_height(), 0);
+    population = 0;
+    current_state.for_each_alive([this](int x, int y) {
+        live_columns[x] = 1;
+        live_rows[y] = 1;
+        population++;
+    });
+    occupancy_known = true;
+}
+
+/**
+ * World::live_span(occupied, toroidal)
+ *
+ * Private helper that finds the smallest run of indices covering every marked entry.
+ * Without a torus this is the run from the first to the last mark. On a torus the run may wrap, so it is
+ * everything except the longest circular gap between marks, a pattern sitting across an edge then gives a
+ * short run instead of one spanning the whole world.
+ *
+ * @param occupied
+ *      The row or column marks from World::find_occupancy.
+ *
+ * @param toroidal
+ *      If true then the run may wrap from the last index to index 0.
+ *
+ * @return
+ *      Returns the run, with length 0 if nothing is marked.
+ */
+
+World::Span World::live_span(const std::vector<char> &occupied, bool toroidal) {
+    const int size = int(occupied.size());
+    const int first = int(std::find(occupied.begin(), occupied.end(), 1) - occupied.begin());
+    if (first == size) {
+        return {0, 0};
+    }
+
+    if (!toroidal) {
+        const int last = int(std::find(occupied.rbegin(), occupied.rend(), 1).base() - occupied.begin());
+        return {first, last - first};
+    }
+
+    // Walk once around the torus from the first mark looking for the longest run of empty entries
+    int gap_start = 0;
+    int gap_length = 0;
+    for (int i = 1, run = 0; i <= size; ++i) {
+        int index = (first + i) % size;
+        if (occupied[index]) {
+            run = 0;
+        } else if (++run > gap_length) {
+            gap_length = run;
+            gap_start = index - run + 1;
+        }
+    }
+    if (gap_length == 0) {
+        return {0, size};
+    }
+    return {(gap_start + gap_length + size) % size, size - gap_length};
+}
+
+/**
+ * World::expand_span(span, size, toroidal)
+ *
+ * Private helper that grows a run by one index on each side, the reach of a cell's neighbourhood.
+ * Without a torus the run is clipped to [0, size), on a torus it wraps and is capped at the whole size.
+ *
+ * @param span
+ *      The run to grow, a run of length 0 stays empty.
+ *
+ * @param size
+ *      The number of rows or columns in the world.
+ *
+ * @param toroidal
+ *      If true then the run may wrap from the last index to index 0.
+ *
+ * @return
+ *      Returns the grown run.
+ */
+
+World::Span World::expand_span(Span span, int size, bool toroidal) {
+    if (span.length == 0) {
+        return span;
+    }
+    if (toroidal) {
+        if (span.length + 2 >= size) {
+            return {0, size};
+        }
+        return {(span.start - 1 + size) % size, span.length + 2};
+    }
+    int start = std::max(0, span.start - 1);
+    int end = std::min(size, span.start + span.length + 1);
+    return {start, end - start};
+}
+
+/**
+ * World::live_bounds(x0, y0, x1, y1)
+ *
+ * Private helper that finds the bounding box [x0, x1) by [y0, y1) of the alive cells in the current state.
+ *
+ * @return
+ *      Returns false and leaves the box empty if there are no alive cells.
+ */
+
+bool World::live_bounds(int &x0, int &y0, int &x1, int &y1) {
+    if (!occupancy_known) {
+        find_occupancy();
+    }
+    Span columns = live_span(live_columns, false);
+    Span rows = live_span(live_rows, false);
+
+    x0 = columns.start;
+    y0 = rows.start;
+    x1 = columns.start + columns.length;
+    y1 = rows.start + rows.length;
+    return rows.length > 0;
+}
+
+/**
+ * World::fit_to_pattern()
+ *
+ * Private helper used by auto-grow, see World::set_auto_grow(margin, shrink).
+ * Re-centres, grows or shrinks the current state around its alive cells and updates the offsets.
+ */
+
+void World::fit_to_pattern() {
+    int x0, y0, x1, y1;
+    if (!live_bounds(x0, y0, x1, y1)) {
+        return;
+    }
+
+    const int width = current_state.get_width();
+    const int height = current_state.get_height();
+    const int needed_width = (x1 - x0) + 2 * grow_margin;
+    const int needed_height = (y1 - y0) + 2 * grow_margin;
+
+    bool near_edge = x0 < grow_margin || y0 < grow_margin || x1 > width - grow_margin || y1 > height - grow_margin;
+    bool too_large = grow_shrink && (width > 4 * needed_width || height > 4 * needed_height);
+    if (!near_edge && !too_large) {
+        return;
+    }
+
+    int new_width = width;
+    int new_height = height;
+    if (new_width < 2 * needed_width) {
+        new_width = std::max(2 * width, 2 * needed_width);
+    } else if (grow_shrink && new_width > 4 * needed_width) {
+        new_width = 2 * needed_width;
+    }
+    if (new_height < 2 * needed_height) {
+        new_height = std::max(2 * height, 2 * needed_height);
+    } else if (grow_shrink && new_height > 4 * needed_height) {
+        new_height = 2 * needed_height;
+    }
+
+    // Place the pattern in the middle of the new grid
+    const int new_x0 = (new_width - (x1 - x0)) / 2;
+    const int new_y0 = (new_height - (y1 - y0)) / 2;
+
+    Grid fitted(new_width, new_height);
+    fitted.merge(current_state.view(x0, y0, x1, y1), new_x0, new_y0);
+    current_state = std::move(fitted);
+    occupancy_known = false;
+    tiles.clear();
+    dirty_tiles.clear();
+
+    offset_x += x0 - new_x0;
+    offset_y += y0 - new_y0;
+}
+
+/**
+ * World::count_changes()
+ *
+ * Private helper that counts the births and deaths of the last step by comparing the current state with the
+ * previous generation left in the next state buffer. Engines do not count them while stepping, so this is only
+ * done when they are asked for.
+ */
+
+void World::count_changes() const {
+    int births = 0;
+    int deaths = 0;
+    for (int y = 0; y < current_state.get_height(); ++y) {
+        const Cell *now = current_state.row(y);
+        const Cell *before = next_state.row(y);
+        for (int x = 0; x < current_state.get_width(); ++x) {
+            births += now[x] == Cell::ALIVE && before[x] == Cell::DEAD;
+            deaths += now[x] == Cell::DEAD && before[x] == Cell::ALIVE;
+        }
+    }
+    last_births = births;
+    last_deaths = deaths;
+    changes_known = true;
+}
+
+/**
+ * World::step_engine(toroidal)
+ *
+ * Private helper that takes one step with the chosen engine instead of the World's own implementation.
+ * The engine writes every cell, so the live rows and columns, the population and the changes are worked out
+ * again when needed.
+ */
+
+void World::step_engine(bool toroidal) {
+    engine->step(current_state, next_state, toroidal);
+    std::swap(current_state, next_state);
+
+    occupancy_known = false;
+    changes_known = false;
+    last_stepped = (long long) current_state.get_width() * current_state.get_height();
+
+    // The previous generation may have been alive anywhere
+    stale_columns = {0, next_state.get_width()};
+    stale_rows = {0, next_state.get_height()};
+
+    std::fill(dirty_tiles.begin(), dirty_tiles.end(), 1);
+}
+
+/**
+ * World::mark_dirty(columns, rows)
+ *
+ * Private helper that marks the snapshot tiles covering a box of the world as needing to be copied again by
+ * World::snapshot. Nothing is marked until the first snapshot is taken.
+ */
+
+void World::mark_dirty(Span columns, Span rows) {
+    const int width = current_state.get_width();
+    const int height = current_state.get_height();
+    const int tiles_x = (width + Snapshot::TILE_SIZE - 1) / Snapshot::TILE_SIZE;
+    if (dirty_tiles.empty() || columns.length <= 0 || rows.length <= 0) {
+        return;
+    }
+
+    // A span wrapping across the edge of a torus is two runs
+    Span column_runs[2] = {{columns.start, std::min(columns.length, width - columns.start)}, {0, 0}};
+    Span row_runs[2] = {{rows.start, std::min(rows.length, height - rows.start)}, {0, 0}};
+    column_runs[1].length = columns.length - column_runs[0].length;
+    row_runs[1].length = rows.length - row_runs[0].length;
+
+    for (const Span &row_run : row_runs) {
+        for (const Span &column_run : column_runs) {
+            if (row_run.length <= 0 || column_run.length <= 0) {
+                continue;
+            }
+            for (int ty = row_run.start / Snapshot::TILE_SIZE;
+                 ty <= (row_run.start + row_run.length - 1) / Snapshot::TILE_SIZE; ++ty) {
+                for (int tx = column_run.start / Snapshot::TILE_SIZE;
+                     tx <= (column_run.start + column_run.length - 1) / Snapshot::TILE_SIZE; ++tx) {
+                    dirty_tiles[ty * tiles_x + tx] = 1;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * World::sync_tile(index, tiles_x)
+ *
+ * Private helper that brings a snapshot tile up to date with the current state.
+ * An unchanged tile is left alone. A changed tile that a snapshot still holds is replaced with a fresh copy,
+ * otherwise it is overwritten in place.
+ */
+
+void World::sync_tile(int index, int tiles_x) {
+    const int x0 = (index % tiles_x) * Snapshot::TILE_SIZE;
+    const int y0 = (index / tiles_x) * Snapshot::TILE_SIZE;
+    const int width = std::min(Snapshot::TILE_SIZE, current_state.get_width() - x0);
+    const int height = std::min(Snapshot::TILE_SIZE, current_state.get_height() - y0);
+    std::shared_ptr<Snapshot::Tile> &tile = tiles[index];
+
+    if (tile) {
+        bool unchanged = true;
+        for (int y = 0; y < height && unchanged; ++y) {
+            const Cell *source = current_state.row(y0 + y) + x0;
+            unchanged = std::equal(source, source + width, tile->cells.data() + y * Snapshot::TILE_SIZE);
+        }
+        if (unchanged) {
+            return;
+        }
+    }
+
+    // Only this thread can add owners, so a count of one means no snapshot can be reading the tile.
+    // use_count is a relaxed load, the fence orders the last reads of a released snapshot before the overwrite.
+    if (!tile || tile.use_count() > 1) {
+        tile = std::make_shared<Snapshot::Tile>();
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    int alive = 0;
+    for (int y = 0; y < height; ++y) {
+        const Cell *source = current_state.row(y0 + y) + x0;
+        std::copy(source, source + width, tile->cells.data() + y * Snapshot::TILE_SIZE);
+        alive += int(std::count(source, source + width, Cell::ALIVE));
+    }
+    tile->alive = alive;
+}
+
 /**
  * World::step(toroidal)
  *
@@ -426,36 +958,103 @@ int World::count_neighbours(int x_cent, int y_cent, bool toroidal) {
  *      - Any live cell with more than three live neighbours dies, as if by overpopulation.
  *      - Any dead cell with exactly three live neighbours becomes a live cell, as if by reproduction.
  *
+ * Only the bounding box of the alive cells expanded by one cell is stepped, everything further away stays dead.
+ * On a torus the box may wrap across the edges. The rows and columns holding alive cells are tracked as the
+ * next state is written, and the next state buffer is reused, clearing only where the generation before last
+ * was alive. The births, deaths and population are counted on the way.
+ *
+ * With auto-grow enabled a non-toroidal step first makes room around the pattern,
+ * see World::set_auto_grow(margin, shrink).
+ * With an engine chosen by World::set_engine(name, retune_every) the engine computes the next state instead.
+ *
  * @param toroidal
  *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
  *      wraps to the right edge and the top to the bottom. Defaults to false.
  */
 
 void World::step(bool toroidal) {
-    next_state = Grid(current_state.get_width(), current_state.get_height());
+    if (!toroidal && grow_margin > 0) {
+        fit_to_pattern();
+    }
 
-    for (int i = 0, x = 0, y = 0; i < current_state.get_total_cells(); ++i, ++x) {
+    if (auto_engine && (since_tune < 0 || (retune_every > 0 && since_tune >= retune_every))) {
+        std::string choice = Engine::tune(current_state, toroidal);
+        engine = choice == "reference" ? nullptr : std::shared_ptr<Engine>(Engine::create(choice));
+        since_tune = 0;
+    }
+    since_tune++;
+    generation++;
 
-        if (x >= current_state.get_width()) {
-            x = 0;
-            y++;
-        }
+    if (engine) {
+        step_engine(toroidal);
+        return;
+    }
+
+    const int width = current_state.get_width();
+    const int height = current_state.get_height();
+
+    // The next state buffer is reused between steps, it only needs replacing when the world changed size
+    if (next_state.get_width() != width || next_state.get_height() != height) {
+        next_state = Grid(width, height);
+        stale_columns = {0, 0};
+        stale_rows = {0, 0};
+    }
+    if (!occupancy_known) {
+        find_occupancy();
+    }
+
+    // Only cells within one cell of the live box can be alive in the next generation
+    Span columns = live_span(live_columns, toroidal);
+    Span rows = live_span(live_rows, toroidal);
+    Span step_columns = expand_span(columns, width, toroidal);
+    Span step_rows = expand_span(rows, height, toroidal);
+
+    // The next state buffer still holds the generation before last, clear the box it was alive in
+    for (int j = 0; j < stale_rows.length; ++j) {
+        Cell *row = next_state.row((stale_rows.start + j) % height);
+        int end = stale_columns.start + stale_columns.length;
+        std::fill(row + stale_columns.start, row + std::min(end, width), Cell::DEAD);
+        std::fill(row, row + std::max(end - width, 0), Cell::DEAD);
+    }
 
-        int num_neighbours = count_neighbours(x, y, toroidal);
+    std::fill(live_columns.begin(), live_columns.end(), 0);
+    std::fill(live_rows.begin(), live_rows.end(), 0);
+    int births = 0;
+    int deaths = 0;
 
-        if (num_neighbours < 2) {
-            next_state.set(x, y, Cell::DEAD);
-        } else if (num_neighbours > 3) {
-            next_state.set(x, y, Cell::DEAD);
-        } else if (num_neighbours == 2) {
-            if (current_state.get(x, y) == Cell::ALIVE) {
-                next_state.set(x, y, Cell::ALIVE);
+    for (int j = 0; j < step_rows.length; ++j) {
+        int y = (step_rows.start + j) % height;
+        Cell *row = next_state.row(y);
+
+        for (int i = 0; i < step_columns.length; ++i) {
+            int x = (step_columns.start + i) % width;
+            int num_neighbours = count_neighbours(x, y, toroidal);
+            Cell cell = current_state.get(x, y);
+
+            if (num_neighbours == 3 || (num_neighbours == 2 && cell == Cell::ALIVE)) {
+                row[x] = Cell::ALIVE;
+                live_columns[x] = 1;
+                live_rows[y] = 1;
+                births += cell == Cell::DEAD;
+            } else {
+                row[x] = Cell::DEAD;
+                deaths += cell == Cell::ALIVE;
             }
-        } else if (num_neighbours == 3) {
-            next_state.set(x, y, Cell::ALIVE);
         }
     }
+
+    last_births = births;
+    last_deaths = deaths;
+    changes_known = true;
+    last_stepped = (long long) step_rows.length * step_columns.length;
+    population += births - deaths;
+
+    stale_columns = columns;
+    stale_rows = rows;
     std::swap(current_state, next_state);
+
+    // Changes since the last generation are all within the stepped box
+    mark_dirty(step_columns, step_rows);
 }
 
 /**
@@ -476,4 +1075,491 @@ void World::advance(int steps, bool toroidal) {
     for (int i = 0; i < steps; ++i) {
         step(toroidal);
     }
-}
\ No newline at end of file
+}
+
+/**
+ * World::generations(steps, toroidal)
+ *
+ * A lazy range over the current state and the next steps generations of the world.
+ * Each element is a reference to the world's own state, so nothing is copied. Advancing the iterator only notes
+ * that a step is owed, the world is stepped when the next element is read, so stopping early, even by an adaptor
+ * like std::views::take that advances past its last element, never computes an unused generation.
+ * The range is single pass, and the world should not be changed any other way while iterating.
+ *
+ * @example
+ *
+ *      // Print every generation until the population falls below 100, or 1000 steps have been taken
+ *      for (const Grid &state : world.generations(1000)) {
+ *          if (state.get_alive_cells() < 100) {
+ *              break;
+ *          }
+ *          std::cout << state << std::endl;
+ *      }
+ *
+ *      // With C++20 ranges the range composes with the standard adaptors
+ *      auto crowded = world.generations(1000) | std::views::take_while([](const Grid &state) {
+ *          return state.get_alive_cells() >= 100;
+ *      });
+ *
+ * @param steps
+ *      The number of generations to step through after the current one.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the steps will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ *
+ * @return
+ *      A World::Generations range of steps + 1 references to the world's state.
+ *
+ * @throws
+ *      std::invalid_argument if the number of steps is negative.
+ */
+
+World::Generations World::generations(int steps, bool toroidal) {
+    if (steps < 0) {
+        throw std::invalid_argument("Steps not valid.");
+    }
+    return Generations(this, steps, toroidal);
+}
+
+/**
+ * World::Generations::Generations(world, steps, toroidal)
+ *
+ * Construct a range over a world, see World::generations.
+ */
+
+World::Generations::Generations(World *world, int steps, bool toroidal)
+        : world(world), steps(steps), toroidal(toroidal) {
+}
+
+/**
+ * World::Generations::begin()
+ *
+ * An iterator at the world's current state.
+ */
+
+World::Generations::iterator World::Generations::begin() const {
+    return iterator(world, steps, toroidal);
+}
+
+/**
+ * World::Generations::end()
+ *
+ * The sentinel the iterator compares equal to once every generation has been passed.
+ */
+
+World::Generations::sentinel World::Generations::end() const {
+    return sentinel();
+}
+
+/**
+ * World::Generations::iterator::iterator(world, remaining, toroidal)
+ *
+ * Construct an iterator at the current state of a world with remaining steps left to take.
+ */
+
+World::Generations::iterator::iterator(World *world, int remaining, bool toroidal)
+        : world(world), remaining(remaining), toroidal(toroidal) {
+}
+
+/**
+ * World::Generations::iterator::catch_up()
+ *
+ * Private helper that takes the step owed by the last advance, if it has not been taken yet.
+ */
+
+void World::Generations::iterator::catch_up() const {
+    if (pending) {
+        pending = false;
+        world->step(toroidal);
+    }
+}
+
+/**
+ * World::Generations::iterator::operator*()
+ *
+ * The world's current state, stepping it first if the iterator was advanced since it was last read.
+ * Valid until the iterator is advanced.
+ */
+
+const Grid &World::Generations::iterator::operator*() const {
+    catch_up();
+    return world->get_state();
+}
+
+/**
+ * World::Generations::iterator::operator->()
+ *
+ * Points at the world's current state, see operator*.
+ */
+
+const Grid *World::Generations::iterator::operator->() const {
+    catch_up();
+    return &world->get_state();
+}
+
+/**
+ * World::Generations::iterator::operator++()
+ *
+ * Move to the next generation, or to the end once the last generation has been passed.
+ * The step itself is taken when the next generation is read, see operator*. Comparing with the end never
+ * needs it, so advancing past the last element read costs nothing.
+ */
+
+World::Generations::iterator &World::Generations::iterator::operator++() {
+    catch_up();
+    pending = remaining > 0;
+    remaining--;
+    return *this;
+}
+
+/**
+ * World::Generations::iterator::operator++(int)
+ *
+ * Advance the iterator, see the prefix operator. An input iterator has no earlier position to return.
+ */
+
+void World::Generations::iterator::operator++(int) {
+    ++*this;
+}
+
+/**
+ * World::get_generation()
+ *
+ * Gets the number of steps taken since the world was made, or since World::set_generation.
+ *
+ * @return
+ *      The generation of the current state.
+ */
+
+int World::get_generation() const {
+    return generation;
+}
+
+/**
+ * World::set_generation(generation)
+ *
+ * Sets the generation counter, for a world resumed from a saved state.
+ *
+ * @param generation
+ *      The generation of the current state.
+ */
+
+void World::set_generation(int generation) {
+    this->generation = generation;
+}
+
+/**
+ * World::snapshot()
+ *
+ * Take an immutable snapshot of the current state that other threads can read while the world keeps stepping.
+ * Call it from the thread stepping the world, the snapshot it returns can then be read from any thread.
+ *
+ * The first snapshot copies the whole state into tiles. After that, steps mark the tiles they may have changed,
+ * and a snapshot only brings those up to date before copying a pointer per tile. Tiles still held by an
+ * older snapshot are replaced rather than overwritten, so older snapshots never change.
+ *
+ * @example
+ *
+ *      // Publish a snapshot for a reader thread every generation
+ *      std::shared_ptr<const Snapshot> latest;
+ *      for (int i = 0; i < 100; ++i) {
+ *          world.step();
+ *          std::atomic_store(&latest, world.snapshot());
+ *      }
+ *
+ *      // On the reader thread
+ *      std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&latest);
+ *      std::cout << snapshot->get_generation() << " " << snapshot->get_alive_cells() << std::endl;
+ *
+ * @return
+ *      A shared, immutable Snapshot of the current state and generation.
+ */
+
+std::shared_ptr<const Snapshot> World::snapshot() {
+    const int width = current_state.get_width();
+    const int height = current_state.get_height();
+    const int tiles_x = (width + Snapshot::TILE_SIZE - 1) / Snapshot::TILE_SIZE;
+    const int tiles_y = (height + Snapshot::TILE_SIZE - 1) / Snapshot::TILE_SIZE;
+    const std::size_t count = std::size_t(tiles_x) * tiles_y;
+
+    if (tiles.size() != count) {
+        tiles.assign(count, nullptr);
+        dirty_tiles.assign(count, 1);
+    }
+
+    std::vector<std::shared_ptr<const Snapshot::Tile>> shared(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (dirty_tiles[i]) {
+            sync_tile(int(i), tiles_x);
+            dirty_tiles[i] = 0;
+        }
+        shared[i] = tiles[i];
+    }
+    return std::make_shared<const Snapshot>(width, height, generation, std::move(shared));
+}
+
+/**
+ * The state shared by a World::Advance handle and its background thread.
+ */
+struct World::Advance::State {
+    World *world;
+    int steps;
+    bool toroidal;
+    Progress progress;
+    int every;
+
+    std::atomic<int> done{0};
+    std::atomic<bool> cancelled{false};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool is_finished = false;
+    std::exception_ptr error;
+    std::thread thread;
+};
+
+/**
+ * World::advance_async(steps, toroidal = false, progress = nullptr, every = 1)
+ *
+ * Advance multiple steps on a background thread, returning straight away with a handle to wait on, cancel,
+ * or check the progress of the advance.
+ * Cancelling or stopping early takes effect between steps, so the world is always left at a completed
+ * generation. The world must not be used any other way until the advance is done, except from the
+ * progress callback.
+ *
+ * @example
+ *
+ *      // Advance up to a million steps, giving up after 10 seconds or once the population falls below 100
+ *      World::Advance advance = world.advance_async(1000000, true, [](const World &world, int) {
+ *          return world.get_alive_cells() >= 100;
+ *      }, 1000);
+ *      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+ *      while (!advance.is_done() && std::chrono::steady_clock::now() < deadline) {
+ *          std::cout << advance.get_done() << " steps, " << advance.get_eta() << "s to go" << std::endl;
+ *          std::this_thread::sleep_for(std::chrono::seconds(1));
+ *      }
+ *      advance.cancel();
+ *      advance.wait();
+ *
+ * @param steps
+ *      The number of steps to advance the world forward.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the steps will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ *
+ * @param progress
+ *      Optional parameter. Called on the background thread every few steps with the world and the number of
+ *      steps done, returning false stops the advance. Defaults to nullptr, no callback.
+ *
+ * @param every
+ *      Optional parameter. The number of steps between calls to the progress callback. Defaults to 1.
+ *
+ * @return
+ *      A World::Advance handle. Destroying the handle cancels the advance and waits for it. A handle that has
+ *      been moved from holds no advance, it reads as done with no steps and waiting on it returns straight away.
+ *
+ * @throws
+ *      std::invalid_argument if the number of steps is negative or every is not positive.
+ */
+
+World::Advance World::advance_async(int steps, bool toroidal, Progress progress, int every) {
+    if (steps < 0) {
+        throw std::invalid_argument("Steps not valid.");
+    }
+    if (every <= 0) {
+        throw std::invalid_argument("Every not valid.");
+    }
+    return Advance(this, steps, toroidal, std::move(progress), every);
+}
+
+/**
+ * World::Advance::Advance(world, steps, toroidal, progress, every)
+ *
+ * Start advancing a world on a background thread, see World::advance_async.
+ */
+
+World::Advance::Advance(World *world, int steps, bool toroidal, Progress progress, int every)
+        : state(std::make_shared<State>()) {
+    state->world = world;
+    state->steps = steps;
+    state->toroidal = toroidal;
+    state->progress = std::move(progress);
+    state->every = every;
+
+    // The thread holds its own reference, so the state outlives a moved-from handle
+    std::shared_ptr<State> shared = state;
+    state->thread = std::thread([shared]() {
+        try {
+            for (int i = 1; i <= shared->steps && !shared->cancelled.load(std::memory_order_relaxed); ++i) {
+                shared->world->step(shared->toroidal);
+                shared->done.store(i, std::memory_order_release);
+
+                if (shared->progress && i % shared->every == 0 && !shared->progress(*shared->world, i)) {
+                    break;
+                }
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->is_finished = true;
+        }
+        shared->finished.notify_all();
+    });
+}
+
+/**
+ * World::Advance::~Advance()
+ *
+ * Cancel the advance and wait for the step in progress to finish, dropping any error.
+ */
+
+World::Advance::~Advance() {
+    if (state) {
+        state->cancelled.store(true);
+        join();
+    }
+}
+
+/**
+ * World::Advance::operator=(other)
+ *
+ * Cancel and wait for the advance this handle holds, then take over the advance of another handle.
+ */
+
+World::Advance &World::Advance::operator=(Advance &&other) {
+    if (this != &other) {
+        if (state) {
+            state->cancelled.store(true);
+            join();
+        }
+        state = std::move(other.state);
+    }
+    return *this;
+}
+
+/**
+ * World::Advance::join()
+ *
+ * Private helper that waits for the background thread to finish and joins it.
+ * The join happens under the mutex, so any number of threads may wait at once and only the first joins.
+ * The background thread never takes the mutex again once it has marked itself finished.
+ */
+
+void World::Advance::join() {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [this] { return state->is_finished; });
+    if (state->thread.joinable()) {
+        state->thread.join();
+    }
+}
+
+/**
+ * World::Advance::wait()
+ *
+ * Block until the advance has finished, been cancelled, or been stopped by the progress callback.
+ * Safe to call more than once and from several threads at once.
+ *
+ * @throws
+ *      Rethrows any exception thrown by a step or by the progress callback.
+ */
+
+void World::Advance::wait() {
+    if (!state) {
+        return;
+    }
+    join();
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        error = state->error;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * World::Advance::cancel()
+ *
+ * Ask the advance to stop after the step in progress. Returns without waiting, see World::Advance::wait.
+ */
+
+void World::Advance::cancel() {
+    if (state) {
+        state->cancelled.store(true);
+    }
+}
+
+/**
+ * World::Advance::is_done()
+ *
+ * Checks if the advance has stopped, whether it finished, was cancelled, stopped early or failed.
+ *
+ * @return
+ *      True once the background thread has stopped stepping the world.
+ */
+
+bool World::Advance::is_done() const {
+    if (!state) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->is_finished;
+}
+
+/**
+ * World::Advance::get_done()
+ *
+ * Gets the number of steps completed so far.
+ *
+ * @return
+ *      The number of completed steps, the world is at its starting generation plus this many.
+ */
+
+int World::Advance::get_done() const {
+    return state ? state->done.load(std::memory_order_acquire) : 0;
+}
+
+/**
+ * World::Advance::get_steps()
+ *
+ * Gets the number of steps the advance was asked for.
+ *
+ * @return
+ *      The number of steps passed to World::advance_async.
+ */
+
+int World::Advance::get_steps() const {
+    return state ? state->steps : 0;
+}
+
+/**
+ * World::Advance::get_eta()
+ *
+ * Estimate the time left from the average time of the steps completed so far.
+ *
+ * @return
+ *      The estimated seconds until every step is done, 0 once the advance is done,
+ *      or -1 before the first step has finished.
+ */
+
+double World::Advance::get_eta() const {
+    const int done = get_done();
+    if (is_done()) {
+        return 0;
+    }
+    if (done == 0) {
+        return -1;
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - state->start).count();
+    return elapsed / done * (state->steps - done);
+}
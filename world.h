@@ -13,7 +13,15 @@
 // Add the minimal number of includes you need in order to declare the class.
 // #include ...
 
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "engine.h"
 #include "grid.h"
+#include "snapshot.h"
 
 /**
  * Declare the structure of the World class for representing a 2d grid world.
@@ -23,12 +31,173 @@
  */
 class World {
 
+public:
+    /**
+     * A lazy, single pass input range over the generations of a world, see World::generations.
+     */
+    class Generations {
+
+    public:
+        /**
+         * Marks the end of the range, reached once the last generation has been passed.
+         */
+        struct sentinel {
+        };
+
+        /**
+         * Refers to the world's current state, the step advancing the iterator is taken when it is next read.
+         */
+        class iterator {
+
+        private:
+            World *world = nullptr;
+            int remaining = -1;
+            bool toroidal = false;
+            mutable bool pending = false;
+
+            void catch_up() const;
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Grid;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Grid *;
+            using reference = const Grid &;
+
+            iterator() = default;
+
+            explicit iterator(World *world, int remaining, bool toroidal);
+
+            reference operator*() const;
+
+            pointer operator->() const;
+
+            iterator &operator++();
+
+            void operator++(int);
+
+            friend bool operator==(const iterator &it, sentinel) { return it.remaining < 0; }
+
+            friend bool operator==(sentinel, const iterator &it) { return it.remaining < 0; }
+
+            friend bool operator!=(const iterator &it, sentinel) { return it.remaining >= 0; }
+
+            friend bool operator!=(sentinel, const iterator &it) { return it.remaining >= 0; }
+        };
+
+    private:
+        World *world;
+        int steps;
+        bool toroidal;
+
+    public:
+        explicit Generations(World *world, int steps, bool toroidal);
+
+        iterator begin() const;
+
+        sentinel end() const;
+    };
+
+    /**
+     * Called from the background thread of World::advance_async, returning false stops the advance early.
+     */
+    using Progress = std::function<bool(const World &world, int done)>;
+
+    /**
+     * A handle on an advance running in the background, see World::advance_async.
+     */
+    class Advance {
+
+    private:
+        struct State;
+
+        std::shared_ptr<State> state;
+
+        void join();
+
+    public:
+        explicit Advance(World *world, int steps, bool toroidal, Progress progress, int every);
+
+        ~Advance();
+
+        Advance(Advance &&) = default;
+
+        Advance &operator=(Advance &&other);
+
+        Advance(const Advance &) = delete;
+
+        Advance &operator=(const Advance &) = delete;
+
+        void wait();
+
+        void cancel();
+
+        bool is_done() const;
+
+        int get_done() const;
+
+        int get_steps() const;
+
+        double get_eta() const;
+    };
+
 private:
+    /**
+     * A run of rows or columns, on a torus the run may wrap past the last index back to 0.
+     */
+    struct Span {
+        int start;
+        int length;
+    };
+
     Grid current_state;
     Grid next_state;
 
+    std::vector<char> live_columns;
+    std::vector<char> live_rows;
+    bool occupancy_known = false;
+    int population = 0;
+    mutable bool changes_known = true;
+    mutable int last_births = 0;
+    mutable int last_deaths = 0;
+    long long last_stepped = 0;
+    Span stale_columns = {0, 0};
+    Span stale_rows = {0, 0};
+
+    int grow_margin = 0;
+    bool grow_shrink = false;
+    int offset_x = 0;
+    int offset_y = 0;
+
+    std::shared_ptr<Engine> engine;
+    bool auto_engine = false;
+    int retune_every = 0;
+    int since_tune = -1;
+
+    int generation = 0;
+    std::vector<std::shared_ptr<Snapshot::Tile>> tiles;
+    std::vector<char> dirty_tiles;
+
     int count_neighbours(int x, int y, bool toroidal);
 
+    void find_occupancy();
+
+    static Span live_span(const std::vector<char> &occupied, bool toroidal);
+
+    static Span expand_span(Span span, int size, bool toroidal);
+
+    bool live_bounds(int &x0, int &y0, int &x1, int &y1);
+
+    void fit_to_pattern();
+
+    void count_changes() const;
+
+    void step_engine(bool toroidal);
+
+    void mark_dirty(Span columns, Span rows);
+
+    void sync_tile(int index, int tiles_x);
+
 public:
     explicit World();
 
@@ -54,7 +223,35 @@ public:
 
     const Grid &get_state() const;
 
+    int get_births() const;
+
+    int get_deaths() const;
+
+    long long get_stepped_cells() const;
+
+    void set_engine(const std::string &name, int retune_every = 0);
+
+    std::string get_engine() const;
+
+    void set_auto_grow(int margin, bool shrink = false);
+
+    int get_offset_x() const;
+
+    int get_offset_y() const;
+
+    void set_offset(int x, int y);
+
+    int get_generation() const;
+
+    void set_generation(int generation);
+
+    std::shared_ptr<const Snapshot> snapshot();
+
     void step(bool toroidal = false);
 
     void advance(int steps, bool toroidal = false);
+
+    Generations generations(int steps, bool toroidal = false);
+
+    Advance advance_async(int steps, bool toroidal = false, Progress progress = nullptr, int every = 1);
 };
\ No newline at end of file
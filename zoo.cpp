@@ -17,16 +17,290 @@
  *              - followed by (width * height) number of individual bits in C-style row/column format,
  *                padded with zero or more 0 bits.
  *              - a 0 bit should be considered Cell::DEAD, a 1 bit should be considered Cell::ALIVE.
+ *          - The body is a plain bitstream, so row ranges map to fixed byte offsets and large files can be
+ *            loaded and saved by several threads at once, each with its own pread or pwrite.
+ *
+ *      - Grids can be loaded from and saved to the Golly Macrocell (.mc) file format.
+ *          - Macrocell files store a deduplicated quadtree, so huge but regular patterns stay small on disk:
+ *              - A "[M2]" header line, followed by optional '#' comment lines.
+ *              - followed by one line per node, numbered from 1 in file order.
+ *              - Leaf nodes are 8x8 blocks written as rows of '.' (Cell::DEAD) and '*' (Cell::ALIVE),
+ *                each row terminated by '$'. Trailing dead cells and empty rows are omitted.
+ *              - Other nodes are written as "level nw ne sw se", where each child is the number of an
+ *                earlier node line, or 0 for an empty child. A level k node spans 2^k by 2^k cells.
+ *              - The last node is the root of the quadtree.
+ *
+ *      - Grids can be loaded from and saved to a tiled snapshot (.tgol) file format.
+ *          - Tiled files are composed of:
+ *              - the 4 byte magic "GOLT"
+ *              - 4 byte ints for the grid width, grid height and tile size.
+ *              - followed by the tiles, each an independently run length encoded bitstream (see codec.cpp)
+ *                of a tile size by tile size square of the grid, clipped at the right and bottom edges.
+ *                Tiles are stored in C-style row/column order.
+ *              - followed by an index holding an 8 byte offset and a 4 byte length for every tile.
+ *              - followed by the 8 byte offset of the index and the 4 byte magic "GOLT".
+ *          - The index lets a region of the grid be loaded by decoding only the tiles that overlap it.
  *
  * @author 958753
  * @date March, 2020
  */
 #include <fstream>
-#include <bitset>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "codec.h"
 #include "grid.h"
 #include "zoo.h"
 
+namespace {
+
+    /**
+     * A node of a Macrocell quadtree.
+     * Leaves (level 3) keep their 8x8 cells as 64 bits in row major order, bit (y * 8 + x).
+     * Other nodes keep the indices of their nw, ne, sw, se children, where 0 is an empty child.
+     * The bounding box of the alive cells is kept relative to the top left corner of the node.
+     */
+    struct MacrocellNode {
+        int level;
+        std::uint64_t leaf;
+        std::array<int, 4> children;
+        bool empty;
+        long long min_x, min_y, max_x, max_y;
+    };
+
+    /**
+     * Hash for the (level, nw, ne, sw, se) key of a Macrocell node, used to deduplicate the quadtree on save.
+     */
+    struct MacrocellKeyHash {
+        std::size_t operator()(const std::array<int, 5> &key) const {
+            std::uint64_t hash = 1469598103934665603ULL;
+            for (int value : key) {
+                hash = (hash ^ std::uint64_t(std::uint32_t(value))) * 1099511628211ULL;
+            }
+            return std::size_t(hash);
+        }
+    };
+
+    /**
+     * Recursively paint the alive cells of a node into the grid.
+     * Empty nodes and nodes outside the grid are skipped without being visited.
+     *
+     * @param nodes
+     *      All nodes of the quadtree, index 0 being the empty node.
+     *
+     * @param index
+     *      The node to paint.
+     *
+     * @param left
+     *      The x coordinate of the top left corner of the node in grid space.
+     *
+     * @param top
+     *      The y coordinate of the top left corner of the node in grid space.
+     *
+     * @param grid
+     *      The grid to paint into.
+     */
+    void paint_macrocell(const std::vector<MacrocellNode> &nodes, int index, long long left, long long top,
+                         Grid &grid) {
+        const MacrocellNode &node = nodes[index];
+
+        if (index == 0 || node.empty) {
+            return;
+        }
+
+        long long size = 1LL << node.level;
+        if (left >= grid.get_width() || top >= grid.get_height() || left + size <= 0 || top + size <= 0) {
+            return;
+        }
+
+        if (node.level == 3) {
+            for (int y = 0; y < 8; ++y) {
+                for (int x = 0; x < 8; ++x) {
+                    if ((node.leaf >> (y * 8 + x)) & 1ULL) {
+                        long long grid_x = left + x;
+                        long long grid_y = top + y;
+                        if (grid_x >= 0 && grid_y >= 0 && grid_x < grid.get_width() && grid_y < grid.get_height()) {
+                            grid(int(grid_x), int(grid_y)) = Cell::ALIVE;
+                        }
+                    }
+                }
+            }
+            return;
+        }
+
+        long long half = size / 2;
+        paint_macrocell(nodes, node.children[0], left, top, grid);
+        paint_macrocell(nodes, node.children[1], left + half, top, grid);
+        paint_macrocell(nodes, node.children[2], left, top + half, grid);
+        paint_macrocell(nodes, node.children[3], left + half, top + half, grid);
+    }
+
+    /**
+     * The number of bytes of a binary file each thread reads or writes at a time.
+     */
+    const std::size_t binary_chunk_size = std::size_t(1) << 22;
+
+    /**
+     * Unpack bytes [first, last) of the body of a binary file into the grid.
+     * Byte b holds cells 8b to 8b + 7, least significant bit first. Bits past the last cell are padding.
+     *
+     * @param bytes
+     *      The bytes of the range, bytes[0] being byte first of the body.
+     *
+     * @param first
+     *      The offset of the first byte of the range in the body.
+     *
+     * @param last
+     *      The offset one past the last byte of the range in the body.
+     *
+     * @param grid
+     *      The grid to unpack into.
+     */
+    void unpack_binary_range(const std::uint8_t *bytes, std::size_t first, std::size_t last, Grid &grid) {
+        std::size_t width = std::size_t(grid.get_width());
+        std::size_t end = std::min(last * 8, std::size_t(grid.get_total_cells()));
+
+        for (std::size_t index = first * 8; index < end;) {
+            int y = int(index / width);
+            std::size_t x = index % width;
+            std::size_t row_end = std::min(end, index - x + width);
+            Cell *cells = grid.row(y);
+
+            for (; index < row_end; ++index, ++x) {
+                std::size_t bit = index - first * 8;
+                cells[x] = ((bytes[bit / 8] >> (bit % 8)) & 1) ? Cell::ALIVE : Cell::DEAD;
+            }
+        }
+    }
+
+    /**
+     * Pack the cells stored in bytes [first, last) of the body of a binary file.
+     * The padding bits of the final byte are written as 0.
+     *
+     * @param grid
+     *      The grid to pack.
+     *
+     * @param first
+     *      The offset of the first byte of the range in the body.
+     *
+     * @param last
+     *      The offset one past the last byte of the range in the body.
+     *
+     * @param bytes
+     *      The bytes of the range to write, bytes[0] being byte first of the body.
+     */
+    void pack_binary_range(ConstGridView grid, std::size_t first, std::size_t last, std::uint8_t *bytes) {
+        std::size_t width = std::size_t(grid.get_width());
+        std::size_t end = std::min(last * 8, std::size_t(grid.get_total_cells()));
+
+        std::fill(bytes, bytes + (last - first), 0);
+
+        for (std::size_t index = first * 8; index < end;) {
+            int y = int(index / width);
+            std::size_t x = index % width;
+            std::size_t row_end = std::min(end, index - x + width);
+            const Cell *cells = grid.row(y);
+
+            for (; index < row_end; ++index, ++x) {
+                std::size_t bit = index - first * 8;
+                bytes[bit / 8] |= std::uint8_t((cells[x] == Cell::ALIVE) << (bit % 8));
+            }
+        }
+    }
+
+    /**
+     * Split the body of a binary file into one contiguous byte range per thread and run a task on each.
+     *
+     * @param body_size
+     *      The number of bytes in the body.
+     *
+     * @param threads
+     *      The number of threads, 0 uses one per core.
+     *
+     * @param task
+     *      Called with the first and one past the last byte of every range, each on its own thread.
+     */
+    template<typename Task>
+    void for_each_binary_range(std::size_t body_size, int threads, Task task) {
+        std::size_t count = threads > 0 ? std::size_t(threads) : std::max(1u, std::thread::hardware_concurrency());
+        count = std::max<std::size_t>(1, std::min(count, body_size / 4096 + 1));
+
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < count; ++t) {
+            std::size_t first = body_size * t / count;
+            std::size_t last = body_size * (t + 1) / count;
+            workers.emplace_back(task, first, last);
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * The fixed size header at the start of a tiled snapshot, and the location of its tile index.
+     */
+    struct TiledHeader {
+        int width;
+        int height;
+        int tile_size;
+        std::uint64_t index_offset;
+    };
+
+    /**
+     * Read and validate the header and footer of a tiled snapshot.
+     *
+     * @param in_file
+     *      An open binary stream positioned anywhere in the file.
+     *
+     * @return
+     *      The parsed header.
+     *
+     * @throws
+     *      std::invalid_argument if the magic numbers, sizes, or index offset are invalid.
+     */
+    TiledHeader read_tiled_header(std::ifstream &in_file) {
+        TiledHeader header{};
+        char magic[4];
+
+        in_file.seekg(0, std::ios::end);
+        std::uint64_t file_size = std::uint64_t(in_file.tellg());
+
+        in_file.seekg(0);
+        in_file.read(magic, 4);
+        in_file.read(reinterpret_cast<char *>(&header.width), 4);
+        in_file.read(reinterpret_cast<char *>(&header.height), 4);
+        in_file.read(reinterpret_cast<char *>(&header.tile_size), 4);
+
+        if (!in_file || std::string(magic, 4) != "GOLT" || header.width < 0 || header.height < 0
+            || header.tile_size <= 0 || file_size < 28) {
+            throw std::invalid_argument("Malformed file.");
+        }
+
+        in_file.seekg(std::streamoff(file_size - 12));
+        in_file.read(reinterpret_cast<char *>(&header.index_offset), 8);
+        in_file.read(magic, 4);
+
+        std::uint64_t tiles_x = (std::uint64_t(header.width) + header.tile_size - 1) / header.tile_size;
+        std::uint64_t tiles_y = (std::uint64_t(header.height) + header.tile_size - 1) / header.tile_size;
+
+        if (!in_file || std::string(magic, 4) != "GOLT" || header.index_offset < 16
+            || header.index_offset + tiles_x * tiles_y * 12 != file_size - 12) {
+            throw std::invalid_argument("Malformed file.");
+        }
+        return header;
+    }
+}
+
 
 /**
  * Zoo::glider()
@@ -223,6 +497,9 @@ Grid Zoo::load_ascii(std::string path) {
  *      // Save a grid to an ascii file in a directory
  *      try {
  *          Zoo::save_ascii("path/to/file.gol", grid);
+ *
+ *          // Save just the top left 4x4 of the grid, without cropping a copy of it first
+ *          Zoo::save_ascii("path/to/corner.gol", grid.view(0, 0, 4, 4));
  *      }
  *      catch (const std::exception &ex) {
  *          std::cerr << ex.what() << std::endl;
@@ -232,24 +509,27 @@ Grid Zoo::load_ascii(std::string path) {
  *      The std::string path to the file to write to.
  *
  * @param grid
- *      The grid to be written out to file.
+ *      The grid, or view of a grid, to be written out to file.
  *
  * @throws
  *      Throws std::runtime_error or sub-class if the file cannot be opened.
  */
 
-void Zoo::save_ascii(std::string path, Grid grid) {
+void Zoo::save_ascii(std::string path, ConstGridView grid) {
     std::ofstream outFile(path);
     if (!outFile.is_open()) {
         throw std::invalid_argument("No such path");
     }
     outFile << grid.get_width() << " " << grid.get_height() << std::endl;
 
+    // Write a row at a time, reading the cells straight from the view.
+    std::string line(std::size_t(grid.get_width()) + 1, '\n');
     for (int y = 0; y < grid.get_height(); ++y) {
+        const Cell *cells = grid.row(y);
         for (int x = 0; x < grid.get_width(); ++x) {
-            outFile << char(grid.get(x, y));
+            line[x] = (cells[x] == Cell::ALIVE) ? char(Cell::ALIVE) : char(Cell::DEAD);
         }
-        outFile << std::endl;
+        outFile.write(line.data(), std::streamsize(line.size()));
     }
 }
 
@@ -275,6 +555,7 @@ void Zoo::save_ascii(std::string path, Grid grid) {
  *      Throws std::runtime_error or sub-class if:
  *          - The file cannot be opened.
  *          - The file ends unexpectedly.
+ *          - The width times the height does not fit in an int.
  */
 
 Grid Zoo::load_binary(std::string path) {
@@ -285,42 +566,31 @@ Grid Zoo::load_binary(std::string path) {
         throw std::invalid_argument("File not found");
     }
 
-    using bits_in_byte = std::bitset<8>;
-
     int width;
     in_file.read(reinterpret_cast<char *>(&width), 4);
     int height;
     in_file.read(reinterpret_cast<char *>(&height), 4);
 
-    Grid grid(width, height);
-
-    std::string bit_string;
-    char c;
-
-    while (in_file.get(c)) {
-        std::string temp;
-        temp = bits_in_byte(c).to_string();
-        std::reverse(temp.begin(), temp.end());
-        bit_string += temp;
+    if (!in_file || width < 0 || height < 0) {
+        throw std::invalid_argument("Malformed file.");
     }
 
-    if (int(bit_string.length()) < grid.get_total_cells()) {
-        throw std::invalid_argument("Malformed file.");
+    if ((long long) width * height > 0x7fffffffLL) {
+        throw std::invalid_argument("Pattern is too large to fit in a grid.");
     }
 
-    for (int j = 0, x = 0, y = 0; j < grid.get_total_cells(); ++j, ++x) {
+    Grid grid(width, height);
 
-        if (x >= grid.get_width()) {
-            x = 0;
-            ++y;
-        }
+    std::size_t body_size = (std::size_t(width) * height + 7) / 8;
+    std::vector<std::uint8_t> bytes(body_size);
+    in_file.read(reinterpret_cast<char *>(bytes.data()), std::streamsize(body_size));
 
-        if (bit_string[j] == '1') {
-            grid.set(x, y, Cell::ALIVE);
-        } else {
-            grid.set(x, y, Cell::DEAD);
-        }
+    if (std::size_t(in_file.gcount()) < body_size) {
+        throw std::invalid_argument("Malformed file.");
     }
+
+    unpack_binary_range(bytes.data(), 0, body_size, grid);
+
     in_file.close();
     return grid;
 }
@@ -348,13 +618,13 @@ Grid Zoo::load_binary(std::string path) {
  *      The std::string path to the file to write to.
  *
  * @param grid
- *      The grid to be written out to file.
+ *      The grid, or view of a grid, to be written out to file.
  *
  * @throws
  *      Throws std::runtime_error or sub-class if the file cannot be opened.
  */
 
-void Zoo::save_binary(std::string path, Grid grid) {
+void Zoo::save_binary(std::string path, ConstGridView grid) {
 
     std::ofstream out_file(path, std::ios::binary);
 
@@ -362,36 +632,750 @@ void Zoo::save_binary(std::string path, Grid grid) {
         throw std::invalid_argument("No such path.");
     }
 
-    using bits_in_byte = std::bitset<8>;
-
     out_file.write(reinterpret_cast<const char *>(&grid.get_width()), 4);
     out_file.write(reinterpret_cast<const char *>(&grid.get_height()), 4);
 
-    std::string temp;
-    for (int i = 0, x = 0, y = 0; i < grid.get_total_cells(); ++i, ++x) {
-        if (x >= grid.get_width()) {
-            x = 0;
-            ++y;
+    std::size_t body_size = (std::size_t(grid.get_total_cells()) + 7) / 8;
+    std::vector<std::uint8_t> bytes(body_size);
+    pack_binary_range(grid, 0, body_size, bytes.data());
+
+    out_file.write(reinterpret_cast<const char *>(bytes.data()), std::streamsize(body_size));
+    out_file.close();
+}
+
+/**
+ * Zoo::load_binary_parallel(path, threads = 0)
+ *
+ * Load a binary .bgol file using several threads, producing the same grid as Zoo::load_binary.
+ * The body of the file is a plain bitstream, so byte b always holds cells 8b to 8b + 7.
+ * The body is split into one contiguous byte range per thread and every thread reads its range
+ * with pread in bounded chunks, unpacking straight into its own slice of the grid.
+ *
+ * @example
+ *
+ *      // Load a large binary file on all available cores
+ *      Grid grid = Zoo::load_binary_parallel("path/to/file.bgol");
+ *
+ * @param path
+ *      The std::string path to the file to read in.
+ *
+ * @param threads
+ *      Optional parameter. The number of threads to use, 0 uses one per core. Defaults to 0.
+ *
+ * @return
+ *      Returns the parsed grid.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if:
+ *          - The file cannot be opened.
+ *          - The file ends unexpectedly.
+ *          - The width times the height does not fit in an int.
+ *          - A read fails.
+ */
+
+Grid Zoo::load_binary_parallel(std::string path, int threads) {
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw std::invalid_argument("File not found");
+    }
+
+    struct stat status{};
+    int header[2];
+
+    if (::fstat(fd, &status) != 0 || ::pread(fd, header, 8, 0) != 8 || header[0] < 0 || header[1] < 0) {
+        ::close(fd);
+        throw std::invalid_argument("Malformed file.");
+    }
+
+    if ((long long) header[0] * header[1] > 0x7fffffffLL) {
+        ::close(fd);
+        throw std::invalid_argument("Pattern is too large to fit in a grid.");
+    }
+
+    std::size_t body_size = (std::size_t(header[0]) * header[1] + 7) / 8;
+
+    if (std::size_t(status.st_size) < 8 + body_size) {
+        ::close(fd);
+        throw std::invalid_argument("Malformed file.");
+    }
+
+    Grid grid(header[0], header[1]);
+
+    std::atomic<bool> failed(false);
+
+    for_each_binary_range(body_size, threads, [&](std::size_t first, std::size_t last) {
+        try {
+            std::vector<std::uint8_t> chunk(std::min(last - first, binary_chunk_size));
+
+            for (std::size_t byte = first; byte < last; byte += chunk.size()) {
+                std::size_t size = std::min(chunk.size(), last - byte);
+
+                for (std::size_t done = 0; done < size;) {
+                    ssize_t count = ::pread(fd, chunk.data() + done, size - done, off_t(8 + byte + done));
+                    if (count <= 0) {
+                        failed.store(true);
+                        return;
+                    }
+                    done += std::size_t(count);
+                }
+
+                unpack_binary_range(chunk.data(), byte, byte + size, grid);
+            }
+        }
+        catch (...) {
+            failed.store(true);
+        }
+    });
+
+    ::close(fd);
+
+    if (failed) {
+        throw std::runtime_error("Failed to read file.");
+    }
+    return grid;
+}
+
+/**
+ * Zoo::save_binary_parallel(path, grid, threads = 0)
+ *
+ * Save a grid as a binary .bgol file using several threads, producing the same file as Zoo::save_binary.
+ * The file is sized up front, then every thread packs its own byte range of the body
+ * in bounded chunks and writes them in place with pwrite.
+ *
+ * @example
+ *
+ *      // Save a large grid on all available cores
+ *      Zoo::save_binary_parallel("path/to/file.bgol", grid);
+ *
+ * @param path
+ *      The std::string path to the file to write to.
+ *
+ * @param grid
+ *      The grid, or view of a grid, to be written out to file.
+ *
+ * @param threads
+ *      Optional parameter. The number of threads to use, 0 uses one per core. Defaults to 0.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the file cannot be opened or a write fails.
+ */
+
+void Zoo::save_binary_parallel(std::string path, ConstGridView grid, int threads) {
+
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        throw std::invalid_argument("No such path.");
+    }
+
+    std::size_t body_size = (std::size_t(grid.get_total_cells()) + 7) / 8;
+    int header[2] = {grid.get_width(), grid.get_height()};
+
+    if (::pwrite(fd, header, 8, 0) != 8 || ::ftruncate(fd, off_t(8 + body_size)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to write file.");
+    }
+
+    std::atomic<bool> failed(false);
+
+    for_each_binary_range(body_size, threads, [&](std::size_t first, std::size_t last) {
+        try {
+            std::vector<std::uint8_t> chunk(std::min(last - first, binary_chunk_size));
+
+            for (std::size_t byte = first; byte < last; byte += chunk.size()) {
+                std::size_t size = std::min(chunk.size(), last - byte);
+                pack_binary_range(grid, byte, byte + size, chunk.data());
+
+                for (std::size_t done = 0; done < size;) {
+                    ssize_t count = ::pwrite(fd, chunk.data() + done, size - done, off_t(8 + byte + done));
+                    if (count <= 0) {
+                        failed.store(true);
+                        return;
+                    }
+                    done += std::size_t(count);
+                }
+            }
+        }
+        catch (...) {
+            failed.store(true);
+        }
+    });
+
+    if (::close(fd) != 0 || failed) {
+        throw std::runtime_error("Failed to write file.");
+    }
+}
+
+/**
+ * Zoo::load_macrocell(path)
+ *
+ * Load a Golly Macrocell (.mc) file and parse it as a grid of cells.
+ * The quadtree is painted straight into the grid, so the full resolution pattern is never
+ * materialised as text and empty quadrants are never visited.
+ *
+ * Files written by Zoo::save_macrocell carry a "#C grid width height" comment and are loaded back
+ * at their original size. Other files are loaded into a grid the size of the bounding box of their alive cells.
+ *
+ * @example
+ *
+ *      // Load a macrocell file from a directory
+ *      Grid grid = Zoo::load_macrocell("path/to/file.mc");
+ *
+ * @param path
+ *      The std::string path to the file to read in.
+ *
+ * @return
+ *      Returns the parsed grid.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if:
+ *          - The file cannot be opened.
+ *          - The file does not start with a "[M2]" header.
+ *          - A node line is malformed or references a node that has not been defined yet.
+ *          - The file describes a multi-state pattern.
+ *          - The pattern is too large to fit in a grid.
+ */
+
+Grid Zoo::load_macrocell(std::string path) {
+
+    std::ifstream in_file(path);
+
+    if (!in_file.is_open()) {
+        throw std::invalid_argument("File not found.");
+    }
+
+    std::string line;
+    if (!std::getline(in_file, line) || line.compare(0, 4, "[M2]") != 0) {
+        throw std::invalid_argument("Missing macrocell header.");
+    }
+
+    // Node 0 is the empty node children refer to.
+    std::vector<MacrocellNode> nodes(1, MacrocellNode{0, 0, {{0, 0, 0, 0}}, true, 0, 0, 0, 0});
+
+    int width = -1;
+    int height = -1;
+
+    while (std::getline(in_file, line)) {
+
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if (line.empty()) {
+            continue;
+        }
+
+        if (line[0] == '#') {
+            if (line.compare(0, 8, "#C grid ") == 0) {
+                std::istringstream fields(line.substr(8));
+                if (!(fields >> width >> height) || width < 0 || height < 0) {
+                    throw std::invalid_argument("Malformed grid size.");
+                }
+                if (static_cast<long long>(width) * height > 0x7fffffffLL) {
+                    throw std::invalid_argument("Pattern is too large to fit in a grid.");
+                }
+            }
+            continue;
         }
 
-        if (grid.get(x, y) == Cell::ALIVE) {
-            temp += '1';
+        MacrocellNode node{3, 0, {{0, 0, 0, 0}}, true, 0, 0, 0, 0};
+
+        if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+
+            for (int i = 0, x = 0, y = 0; i < int(line.length()); ++i) {
+                if (line[i] == '$') {
+                    x = 0;
+                    y++;
+                    continue;
+                }
+
+                if ((line[i] != '.' && line[i] != '*') || x >= 8 || y >= 8) {
+                    throw std::invalid_argument("Malformed leaf node.");
+                }
+
+                if (line[i] == '*') {
+                    node.leaf |= 1ULL << (y * 8 + x);
+
+                    node.min_x = node.empty ? x : std::min<long long>(node.min_x, x);
+                    node.min_y = node.empty ? y : std::min<long long>(node.min_y, y);
+                    node.max_x = node.empty ? x : std::max<long long>(node.max_x, x);
+                    node.max_y = node.empty ? y : std::max<long long>(node.max_y, y);
+                    node.empty = false;
+                }
+                x++;
+            }
+
         } else {
-            temp += '0';
+
+            std::istringstream fields(line);
+            if (!(fields >> node.level >> node.children[0] >> node.children[1]
+                        >> node.children[2] >> node.children[3])) {
+                throw std::invalid_argument("Malformed node.");
+            }
+
+            if (node.level < 4) {
+                throw std::invalid_argument("Multi-state macrocell files are not supported.");
+            }
+
+            if (node.level > 62) {
+                throw std::invalid_argument("Macrocell node is too large.");
+            }
+
+            long long half = 1LL << (node.level - 1);
+
+            for (int child = 0; child < 4; ++child) {
+                int index = node.children[child];
+
+                if (index < 0 || index >= int(nodes.size())
+                    || (index != 0 && nodes[index].level != node.level - 1)) {
+                    throw std::invalid_argument("Malformed node.");
+                }
+
+                const MacrocellNode &other = nodes[index];
+                if (index == 0 || other.empty) {
+                    continue;
+                }
+
+                long long left = (child % 2) * half;
+                long long top = (child / 2) * half;
+
+                node.min_x = node.empty ? left + other.min_x : std::min(node.min_x, left + other.min_x);
+                node.min_y = node.empty ? top + other.min_y : std::min(node.min_y, top + other.min_y);
+                node.max_x = node.empty ? left + other.max_x : std::max(node.max_x, left + other.max_x);
+                node.max_y = node.empty ? top + other.max_y : std::max(node.max_y, top + other.max_y);
+                node.empty = false;
+            }
+        }
+
+        nodes.push_back(node);
+    }
+    in_file.close();
+
+    int root = int(nodes.size()) - 1;
+
+    // Files we wrote ourselves keep the grid anchored at the top left corner of the root node.
+    if (width >= 0 && height >= 0) {
+        Grid grid(width, height);
+        paint_macrocell(nodes, root, 0, 0, grid);
+        return grid;
+    }
+
+    if (nodes[root].empty) {
+        return Grid();
+    }
+
+    long long bounding_width = nodes[root].max_x - nodes[root].min_x + 1;
+    long long bounding_height = nodes[root].max_y - nodes[root].min_y + 1;
+
+    if (bounding_width * bounding_height > 0x7fffffffLL) {
+        throw std::invalid_argument("Pattern is too large to fit in a grid.");
+    }
+
+    Grid grid(static_cast<int>(bounding_width), static_cast<int>(bounding_height));
+    paint_macrocell(nodes, root, -nodes[root].min_x, -nodes[root].min_y, grid);
+    return grid;
+}
+
+/**
+ * Zoo::save_macrocell(path, grid)
+ *
+ * Save a grid as a Golly Macrocell .mc file according to the specified file format.
+ * The grid is anchored at the top left corner of the smallest quadtree that covers it,
+ * and identical quadrants are written once and shared, so regular patterns compress very well.
+ * A "#C grid width height" comment records the size of the grid for Zoo::load_macrocell.
+ *
+ * @example
+ *
+ *      // Make an 8x8 grid
+ *      Grid grid(8);
+ *
+ *      // Save a grid to a macrocell file in a directory
+ *      try {
+ *          Zoo::save_macrocell("path/to/file.mc", grid);
+ *      }
+ *      catch (const std::exception &ex) {
+ *          std::cerr << ex.what() << std::endl;
+ *      }
+ *
+ * @param path
+ *      The std::string path to the file to write to.
+ *
+ * @param grid
+ *      The grid, or view of a grid, to be written out to file.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the file cannot be opened.
+ */
+
+void Zoo::save_macrocell(std::string path, ConstGridView grid) {
+
+    std::ofstream out_file(path);
+
+    if (!out_file.is_open()) {
+        throw std::invalid_argument("No such path.");
+    }
+
+    out_file << "[M2] (Game of Life)\n"
+             << "#R B3/S23\n"
+             << "#C grid " << grid.get_width() << " " << grid.get_height() << "\n";
+
+    int next_index = 1;
+
+    // Build the leaf layer from 8x8 blocks of the grid, sharing identical leaves.
+    int layer_width = (grid.get_width() + 7) / 8;
+    int layer_height = (grid.get_height() + 7) / 8;
+    std::vector<int> layer(std::size_t(layer_width) * layer_height, 0);
+    std::unordered_map<std::uint64_t, int> leaves;
+
+    for (int block_y = 0; block_y < layer_height; ++block_y) {
+        for (int block_x = 0; block_x < layer_width; ++block_x) {
+
+            std::uint64_t leaf = 0;
+            for (int y = 0; y < 8 && block_y * 8 + y < grid.get_height(); ++y) {
+                for (int x = 0; x < 8 && block_x * 8 + x < grid.get_width(); ++x) {
+                    if (grid(block_x * 8 + x, block_y * 8 + y) == Cell::ALIVE) {
+                        leaf |= 1ULL << (y * 8 + x);
+                    }
+                }
+            }
+
+            if (leaf == 0) {
+                continue;
+            }
+
+            auto found = leaves.find(leaf);
+            if (found == leaves.end()) {
+                std::string text;
+                for (int y = 0; y < 8; ++y) {
+                    int row = int((leaf >> (y * 8)) & 0xff);
+                    for (int x = 0; row >> x; ++x) {
+                        text += ((row >> x) & 1) ? '*' : '.';
+                    }
+                    text += '$';
+                }
+                text.erase(text.find_last_not_of('$') + 2);
+                out_file << text << "\n";
+
+                found = leaves.emplace(leaf, next_index++).first;
+            }
+            layer[std::size_t(block_y) * layer_width + block_x] = found->second;
         }
+    }
+
+    // Combine each 2x2 group of nodes into its parent until a single root covers the whole grid.
+    std::unordered_map<std::array<int, 5>, int, MacrocellKeyHash> parents;
+    int level = 3;
+
+    while (layer_width > 1 || layer_height > 1 || level == 3) {
+        level++;
+
+        int parent_width = (layer_width + 1) / 2;
+        int parent_height = (layer_height + 1) / 2;
+        std::vector<int> parent_layer(std::size_t(parent_width) * parent_height, 0);
+
+        for (int y = 0; y < parent_height; ++y) {
+            for (int x = 0; x < parent_width; ++x) {
+
+                std::array<int, 5> key = {{level, 0, 0, 0, 0}};
+                for (int child = 0; child < 4; ++child) {
+                    int child_x = x * 2 + child % 2;
+                    int child_y = y * 2 + child / 2;
+                    if (child_x < layer_width && child_y < layer_height) {
+                        key[child + 1] = layer[std::size_t(child_y) * layer_width + child_x];
+                    }
+                }
 
-        if ((i + 1) % 8 == 0) {
-            std::reverse(temp.begin(), temp.end());
-            char cur_char = bits_in_byte(temp).to_ulong();
-            out_file.write((char *) &cur_char, sizeof(char));
-            temp.clear();
+                if (key[1] == 0 && key[2] == 0 && key[3] == 0 && key[4] == 0) {
+                    continue;
+                }
+
+                auto found = parents.find(key);
+                if (found == parents.end()) {
+                    out_file << key[0] << " " << key[1] << " " << key[2] << " " << key[3] << " " << key[4] << "\n";
+                    found = parents.emplace(key, next_index++).first;
+                }
+                parent_layer[std::size_t(y) * parent_width + x] = found->second;
+            }
         }
+
+        std::swap(layer, parent_layer);
+        layer_width = parent_width;
+        layer_height = parent_height;
+    }
+
+    // An empty grid still needs a root node.
+    if (layer.empty() || layer[0] == 0) {
+        out_file << level << " 0 0 0 0\n";
+    }
+
+    out_file.close();
+}
+
+/**
+ * Zoo::load_tiled(path)
+ *
+ * Load a whole tiled snapshot .tgol file and parse it as a grid of cells.
+ * Equivalent to Zoo::load_region over the full extent of the grid.
+ *
+ * @example
+ *
+ *      // Load a tiled snapshot from a directory
+ *      Grid grid = Zoo::load_tiled("path/to/file.tgol");
+ *
+ * @param path
+ *      The std::string path to the file to read in.
+ *
+ * @return
+ *      Returns the parsed grid.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if:
+ *          - The file cannot be opened.
+ *          - The header, index, or a tile is malformed.
+ */
+
+Grid Zoo::load_tiled(std::string path) {
+
+    std::ifstream in_file(path, std::ios::binary);
+
+    if (!in_file.is_open()) {
+        throw std::invalid_argument("File not found.");
+    }
+
+    TiledHeader header = read_tiled_header(in_file);
+    in_file.close();
+
+    return load_region(path, 0, 0, header.width, header.height);
+}
+
+/**
+ * Zoo::load_region(path, x0, y0, x1, y1)
+ *
+ * Load the region [x0, x1) by [y0, y1) of a tiled snapshot .tgol file, as if the whole grid
+ * had been loaded and then cropped with Grid::crop. Only the tiles that overlap the region are
+ * read from disk and decoded, so a small window of a huge snapshot loads in time proportional to the window.
+ *
+ * @example
+ *
+ *      // Load the top left 64x64 corner of a tiled snapshot
+ *      Grid corner = Zoo::load_region("path/to/file.tgol", 0, 0, 64, 64);
+ *
+ * @param path
+ *      The std::string path to the file to read in.
+ *
+ * @param x0
+ *      Left coordinate of the region on x-axis.
+ *
+ * @param y0
+ *      Top coordinate of the region on y-axis.
+ *
+ * @param x1
+ *      Right coordinate of the region on x-axis (1 greater than the largest index).
+ *
+ * @param y1
+ *      Bottom coordinate of the region on y-axis (1 greater than the largest index).
+ *
+ * @return
+ *      Returns a grid of the region size containing the cells of the region.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if:
+ *          - The file cannot be opened.
+ *          - The header, index, or an overlapping tile is malformed.
+ *          - The region is not within the grid or has a negative size.
+ */
+
+Grid Zoo::load_region(std::string path, int x0, int y0, int x1, int y1) {
+
+    std::ifstream in_file(path, std::ios::binary);
+
+    if (!in_file.is_open()) {
+        throw std::invalid_argument("File not found.");
+    }
+
+    TiledHeader header = read_tiled_header(in_file);
+
+    if (x0 < 0 || y0 < 0 || x1 < x0 || y1 < y0 || x1 > header.width || y1 > header.height) {
+        throw std::range_error("Region is not in the required ranges.");
+    }
+
+    Grid grid(x1 - x0, y1 - y0);
+
+    if (grid.get_total_cells() == 0) {
+        return grid;
+    }
+
+    int tile_size = header.tile_size;
+    int tiles_x = int((std::int64_t(header.width) + tile_size - 1) / tile_size);
+
+    for (int tile_y = y0 / tile_size; tile_y <= (y1 - 1) / tile_size; ++tile_y) {
+        for (int tile_x = x0 / tile_size; tile_x <= (x1 - 1) / tile_size; ++tile_x) {
+
+            std::uint64_t offset;
+            std::uint32_t length;
+
+            in_file.seekg(std::streamoff(header.index_offset + (std::uint64_t(tile_y) * tiles_x + tile_x) * 12));
+            in_file.read(reinterpret_cast<char *>(&offset), 8);
+            in_file.read(reinterpret_cast<char *>(&length), 4);
+
+            if (!in_file || offset + length > header.index_offset) {
+                throw std::invalid_argument("Malformed file.");
+            }
+
+            std::vector<std::uint8_t> compressed(length);
+            in_file.seekg(std::streamoff(offset));
+            in_file.read(reinterpret_cast<char *>(compressed.data()), length);
+
+            if (!in_file) {
+                throw std::invalid_argument("Malformed file.");
+            }
+
+            int left = tile_x * tile_size;
+            int top = tile_y * tile_size;
+            int width = std::min(tile_size, header.width - left);
+            int height = std::min(tile_size, header.height - top);
+
+            std::vector<std::uint8_t> bits = Codec::rle_decode(compressed,
+                                                               (std::size_t(width) * height + 7) / 8);
+            Codec::unpack_bits(bits, width, height, grid, left - x0, top - y0);
+        }
+    }
+    in_file.close();
+
+    return grid;
+}
+
+/**
+ * Zoo::save_tiled(path, grid, tile_size = 256)
+ *
+ * Save a grid as a tiled snapshot .tgol file according to the specified file format.
+ * Tiles are compressed in parallel by one pool of threads, one per core, that take tile indices in order from a
+ * shared counter while the calling thread writes the compressed tiles out in order. A thread never runs more than
+ * four tiles per thread ahead of the writer, so only a bounded number of compressed tiles are held in memory.
+ *
+ * @example
+ *
+ *      // Make a 4096x4096 grid
+ *      Grid grid(4096);
+ *
+ *      // Save a grid to a tiled snapshot in a directory using 512x512 tiles
+ *      try {
+ *          Zoo::save_tiled("path/to/file.tgol", grid, 512);
+ *      }
+ *      catch (const std::exception &ex) {
+ *          std::cerr << ex.what() << std::endl;
+ *      }
+ *
+ * @param path
+ *      The std::string path to the file to write to.
+ *
+ * @param grid
+ *      The grid, or view of a grid, to be written out to file.
+ *
+ * @param tile_size
+ *      Optional parameter. The edge size of the square tiles. Defaults to 256.
+ *
+ * @throws
+ *      Throws std::runtime_error or sub-class if the file cannot be opened or the tile size is not positive.
+ */
+
+void Zoo::save_tiled(std::string path, ConstGridView grid, int tile_size) {
+
+    if (tile_size <= 0) {
+        throw std::invalid_argument("Tile size must be positive.");
+    }
+
+    std::ofstream out_file(path, std::ios::binary);
+
+    if (!out_file.is_open()) {
+        throw std::invalid_argument("No such path.");
+    }
+
+    out_file.write("GOLT", 4);
+    out_file.write(reinterpret_cast<const char *>(&grid.get_width()), 4);
+    out_file.write(reinterpret_cast<const char *>(&grid.get_height()), 4);
+    out_file.write(reinterpret_cast<const char *>(&tile_size), 4);
+
+    // A tile size of 1 on a large grid has more tiles than an int can count
+    std::int64_t tiles_x = (std::int64_t(grid.get_width()) + tile_size - 1) / tile_size;
+    std::int64_t tiles_y = (std::int64_t(grid.get_height()) + tile_size - 1) / tile_size;
+    std::int64_t tile_count = tiles_x * tiles_y;
+
+    int thread_count = int(std::min<std::int64_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                                  std::max<std::int64_t>(1, tile_count)));
+    std::int64_t window = std::int64_t(thread_count) * 4;
+
+    std::vector<std::uint64_t> offsets(static_cast<std::size_t>(tile_count));
+    std::vector<std::uint32_t> lengths(static_cast<std::size_t>(tile_count));
+
+    // Tile t is compressed into slot t % window, once the tile before it in that slot has been written out
+    std::vector<std::vector<std::uint8_t>> slots(static_cast<std::size_t>(window));
+    std::vector<char> ready(static_cast<std::size_t>(window), 0);
+    std::int64_t written = 0;
+    std::mutex mutex;
+    std::condition_variable compressed;
+    std::condition_variable drained;
+    std::atomic<std::int64_t> next(0);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < thread_count; ++t) {
+        workers.emplace_back([&]() {
+            for (std::int64_t tile = next++; tile < tile_count; tile = next++) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    drained.wait(lock, [&] { return tile < written + window; });
+                }
+
+                int left = int((tile % tiles_x) * tile_size);
+                int top = int((tile / tiles_x) * tile_size);
+                int right = int(std::min<std::int64_t>(grid.get_width(), std::int64_t(left) + tile_size));
+                int bottom = int(std::min<std::int64_t>(grid.get_height(), std::int64_t(top) + tile_size));
+                std::vector<std::uint8_t> bytes = Codec::rle_encode(Codec::pack_bits(grid, left, top, right, bottom));
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    slots[tile % window] = std::move(bytes);
+                    ready[tile % window] = 1;
+                }
+                compressed.notify_one();
+            }
+        });
+    }
+
+    std::uint64_t offset = 16;
+    for (std::int64_t tile = 0; tile < tile_count; ++tile) {
+        std::vector<std::uint8_t> bytes;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            compressed.wait(lock, [&] { return ready[tile % window] != 0; });
+            bytes = std::move(slots[tile % window]);
+            ready[tile % window] = 0;
+            written = tile + 1;
+        }
+        drained.notify_all();
+
+        out_file.write(reinterpret_cast<const char *>(bytes.data()), std::streamsize(bytes.size()));
+        offsets[tile] = offset;
+        lengths[tile] = std::uint32_t(bytes.size());
+        offset += bytes.size();
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    std::uint64_t index_offset = offset;
+    for (std::int64_t tile = 0; tile < tile_count; ++tile) {
+        out_file.write(reinterpret_cast<const char *>(&offsets[tile]), 8);
+        out_file.write(reinterpret_cast<const char *>(&lengths[tile]), 4);
     }
+    out_file.write(reinterpret_cast<const char *>(&index_offset), 8);
+    out_file.write("GOLT", 4);
 
-    if (grid.get_total_cells() % 8 != 0) {
-        std::reverse(temp.begin(), temp.end());
-        char cur_char = bits_in_byte(temp).to_ulong();
-        out_file.write((char *) &cur_char, sizeof(char));
+    if (!out_file) {
+        throw std::runtime_error("Failed to write file.");
     }
     out_file.close();
 }
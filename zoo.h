@@ -27,9 +27,23 @@ namespace Zoo {
 
     Grid load_ascii(std::string path);
 
-    void save_ascii(std::string path, Grid grid);
+    void save_ascii(std::string path, ConstGridView grid);
 
     Grid load_binary(std::string path);
 
-    void save_binary(std::string path, Grid grid);
+    void save_binary(std::string path, ConstGridView grid);
+
+    Grid load_binary_parallel(std::string path, int threads = 0);
+
+    void save_binary_parallel(std::string path, ConstGridView grid, int threads = 0);
+
+    Grid load_macrocell(std::string path);
+
+    void save_macrocell(std::string path, ConstGridView grid);
+
+    Grid load_tiled(std::string path);
+
+    Grid load_region(std::string path, int x0, int y0, int x1, int y1);
+
+    void save_tiled(std::string path, ConstGridView grid, int tile_size = 256);
 };
\ No newline at end of file